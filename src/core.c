@@ -9,27 +9,101 @@
 #include "include/simcom/core.h"
 #include "include/simcom/utils.h"
 #include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
 
 
-static void str2Time(SIM_Datetime_t*, const char *);
+static SIM_Status_t str2Time(SIM_Datetime_t*, const char *);
+static uint32_t daysFromCivil(uint16_t year, uint8_t month, uint8_t day);
+static int16_t appendCommand(char *line, uint16_t lineLen, SIM_BatchCmd_t*);
+static SIM_Status_t checkATResult(SIM_HandlerTypeDef*, SIM_Status_t);
+static uint8_t actToRAT(int32_t act);
+static int32_t ratToAcT(uint8_t rat);
 
-SIM_Status_t SIM_CheckAT(SIM_HandlerTypeDef *hsim)
+
+/*
+ * Runs setter commands with as few round-trips as possible. Commands are
+ * concatenated into one "AT+A=..;+B=.." line while they fit in
+ * SIM_BATCH_LINE_SIZE, a command with parameters that can't be rendered is
+ * sent alone. Like a sequence of AT_Command calls it stops at the first
+ * failing command, the ones after it keep the SIM_ERROR status. The modem
+ * stops a line there too, so on ERROR the commands of that line are repeated
+ * one by one up to the failing one; the ones before it run twice. Only use
+ * it for idempotent commands without information response.
+ */
+SIM_Status_t SIM_CommandBatch(SIM_HandlerTypeDef *hsim, SIM_BatchCmd_t *cmds, uint8_t cmdNb)
 {
-  SIM_Status_t status = SIM_ERROR;
+  char line[SIM_BATCH_LINE_SIZE];
+  int16_t lineLen;
+  int16_t newLen;
+  uint8_t first;
+  uint8_t i = 0;
+
+  while (i < cmdNb) {
+    first = i;
+    lineLen = 0;
+    line[0] = 0;
+
+    while (i < cmdNb) {
+      newLen = appendCommand(line, lineLen, &cmds[i]);
+      if (newLen < 0) break;
+      lineLen = newLen;
+      i++;
+    }
 
-  if (AT_Command(&hsim->atCmd, "", 0, 0, 0, 0) == AT_OK) {
-    status = SIM_OK;
-    if (hsim->state <= SIM_STATE_CHECK_AT) {
-      hsim->state = SIM_STATE_CHECK_AT+1;
+    if (i == first) {
+      if (AT_Command(&hsim->atCmd, cmds[i].cmd, cmds[i].paramNb,
+                     cmds[i].params, 0, 0) != AT_OK)
+        return SIM_ERROR;
+      cmds[i++].status = SIM_OK;
+      continue;
+    }
+
+    if (AT_Command(&hsim->atCmd, line, 0, 0, 0, 0) == AT_OK) {
+      for (uint8_t j = first; j < i; j++) {
+        cmds[j].status = SIM_OK;
+      }
+      continue;
+    }
+
+    for (uint8_t j = first; j < i; j++) {
+      if (AT_Command(&hsim->atCmd, cmds[j].cmd, cmds[j].paramNb,
+                     cmds[j].params, 0, 0) != AT_OK)
+        return SIM_ERROR;
+      cmds[j].status = SIM_OK;
     }
-    SIM_Echo(hsim, 0);
-    SIM_SET_STATUS(hsim, SIM_STATUS_ACTIVE);
-  } else {
-    hsim->state = SIM_STATE_CHECK_AT;
-    SIM_UNSET_STATUS(hsim, SIM_STATUS_ACTIVE);
   }
 
-  return status;
+  return SIM_OK;
+}
+
+SIM_Status_t SIM_CheckAT(SIM_HandlerTypeDef *hsim)
+{
+  // "ATE0" answers like "AT" does, so it probes and disables echo at once
+  return checkATResult(hsim, SIM_Echo(hsim, 0));
+}
+
+
+// same as SIM_CheckAT but gives up after a short timeout,
+// used while the modem may still be booting
+SIM_Status_t SIM_ProbeAT(SIM_HandlerTypeDef *hsim, uint32_t timeout)
+{
+  AT_Status_t result;
+
+#if SIM_EN_AT_HOOK
+  // the other threads wait instead of running with the probe timeout
+  result = SIM_AT_CommandTimeout(&hsim->atCmd, "E0", timeout);
+#else
+  // without the hooks there is no gate, only the application could send
+  // a command before the modem answered its first one
+  uint32_t defaultTimeout = hsim->atCmd.config.timeout;
+
+  hsim->atCmd.config.timeout = timeout;
+  result = AT_Command(&hsim->atCmd, "E0", 0, 0, 0, 0);
+  hsim->atCmd.config.timeout = defaultTimeout;
+#endif
+
+  return checkATResult(hsim, (result == AT_OK)? SIM_OK: SIM_ERROR);
 }
 
 
@@ -47,40 +121,94 @@ SIM_Status_t SIM_Echo(SIM_HandlerTypeDef *hsim, uint8_t onoff)
 
 SIM_Status_t SIM_CheckSIMCard(SIM_HandlerTypeDef *hsim)
 {
-  SIM_Status_t status = SIM_ERROR;
-  uint8_t respstr[6];
+  char respstr[16];
   AT_Data_t respData[1] = {
     AT_Buffer(respstr, sizeof(respstr)),
   };
 
-  memset(respstr, 0, 6);
+  memset(respstr, 0, sizeof(respstr));
 
-  AT_Check(&hsim->atCmd, "+CPIN", 1, respData);
-  if (strncmp(respData[0].value.string, "READY", 5) == 0) {
-    status = SIM_OK;
+  if (AT_Check(&hsim->atCmd, "+CPIN", 1, respData) != AT_OK) return SIM_ERROR;
+  SIM_UpdateSIMCard(hsim, SIM_ParseSIMCard(respstr));
+
+  return (hsim->simcard == SIM_CARD_READY)? SIM_OK: SIM_ERROR;
+}
+
+
+// <code> of +CPIN, also "NOT AVAILABLE" of the +SIMCARD hot-swap URC
+uint8_t SIM_ParseSIMCard(const char *status)
+{
+  static const struct {
+    const char  *str;
+    uint8_t     status;
+  } codes[] = {
+    {"READY",         SIM_CARD_READY},
+    {"SIM PIN",       SIM_CARD_PIN},
+    {"SIM PUK",       SIM_CARD_PUK},
+    {"SIM PIN2",      SIM_CARD_PIN2},
+    {"SIM PUK2",      SIM_CARD_PUK2},
+    {"PH-SIM PIN",    SIM_CARD_PH_PIN},
+    {"PH-NET PIN",    SIM_CARD_PH_PIN},
+    {"NOT READY",     SIM_CARD_NOT_READY},
+    {"NOT INSERTED",  SIM_CARD_NOT_INSERTED},
+    {"SIM REMOVED",   SIM_CARD_NOT_INSERTED},
+    {"NOT AVAILABLE", SIM_CARD_NOT_INSERTED},
+  };
+
+  for (uint8_t i = 0; i < sizeof(codes)/sizeof(codes[0]); i++) {
+    if (strcmp(status, codes[i].str) == 0) return codes[i].status;
   }
-  return status;
+  return SIM_CARD_UNKNOWN;
+}
+
+
+void SIM_UpdateSIMCard(SIM_HandlerTypeDef *hsim, uint8_t status)
+{
+  if (hsim->simcard == status) return;
+
+  hsim->simcard = status;
+  if (hsim->onSIMCard != 0) hsim->onSIMCard(status);
+}
+
+
+// card detection through the SIM holder switch, reported with +SIMCARD
+SIM_Status_t SIM_SetSIMCardHotSwap(SIM_HandlerTypeDef *hsim, uint8_t enable)
+{
+  AT_Data_t paramData[1] = {
+    AT_Number(enable? 1: 0),
+  };
+
+  if (AT_Command(&hsim->atCmd, "+UIMHOTSWAPON", 1, paramData, 0, 0) != AT_OK) return SIM_ERROR;
+
+  if (enable) {
+    SIM_SET_STATUS(hsim, SIM_STATUS_HOTSWAP_ON);
+  } else {
+    SIM_UNSET_STATUS(hsim, SIM_STATUS_HOTSWAP_ON);
+  }
+  return SIM_OK;
 }
 
 
 SIM_Status_t SIM_CheckNetwork(SIM_HandlerTypeDef *hsim)
 {
   SIM_Status_t status = SIM_ERROR;
-  uint8_t lac[2]; // location area code
-  uint8_t ci[2];  // Cell Identify
+  char lac[SIM_CELL_STR_SIZE]; // location area code
+  char ci[SIM_CELL_STR_SIZE];  // Cell Identify
 
-  AT_Data_t respData[4] = {
+  AT_Data_t respData[5] = {
     AT_Number(0),
     AT_Number(0),
-    AT_Hex(lac),
-    AT_Hex(ci),
+    AT_Buffer(lac, SIM_CELL_STR_SIZE),
+    AT_Buffer(ci, SIM_CELL_STR_SIZE),
+    AT_Number(-1),
   };
 
-  memset(lac, 0, 2);
-  memset(ci, 0, 2);
+  memset(lac, 0, SIM_CELL_STR_SIZE);
+  memset(ci, 0, SIM_CELL_STR_SIZE);
 
-  if (AT_Check(&hsim->atCmd, "+CREG", 4, respData) != AT_OK) return status;
+  if (AT_Check(&hsim->atCmd, "+CREG", 5, respData) != AT_OK) return status;
   hsim->network_status = (uint8_t) respData[1].value.number;
+  SIM_OnRegistrationCell(hsim, &respData[1]);
 
   // check response
   if (hsim->network_status == 1 || hsim->network_status == 5) {
@@ -92,8 +220,11 @@ SIM_Status_t SIM_CheckNetwork(SIM_HandlerTypeDef *hsim)
       SIM_SET_STATUS(hsim, SIM_STATUS_ROAMING);
   }
   else {
-    if (hsim->state > SIM_STATE_CHECK_NETWORK)
+    if (hsim->state > SIM_STATE_CHECK_NETWORK) {
+      SIM_TRACE(hsim, SIM_TRACE_MOD_CORE, hsim->state, SIM_STATE_CHECK_NETWORK,
+                SIM_TRACE_CAUSE_ERROR);
       hsim->state = SIM_STATE_CHECK_NETWORK;
+    }
     SIM_UNSET_STATUS(hsim, SIM_STATUS_ROAMING);
   }
 
@@ -137,6 +268,233 @@ endCmd:
 }
 
 
+// operator restored from NVM after SIM_Init, tried first on boot
+void SIM_SetLastOperator(SIM_HandlerTypeDef *hsim, const SIM_Operator_t *op)
+{
+  memcpy(&hsim->reg.last, op, sizeof(SIM_Operator_t));
+  hsim->reg.last.plmn[sizeof(hsim->reg.last.plmn) - 1] = 0;
+}
+
+
+// starts the registration of a boot, on the last operator when it is known
+// so the modem does not scan every band. +COPS=4 falls back to automatic
+// selection by itself when that operator is gone.
+SIM_Status_t SIM_SelectOperator(SIM_HandlerTypeDef *hsim)
+{
+  SIM_Operator_t *last = &hsim->reg.last;
+  AT_Data_t paramData[4] = {
+    AT_Number(4),
+    AT_Number(2),
+    AT_String(last->plmn),
+    AT_Number(ratToAcT(last->rat)),
+  };
+
+  hsim->reg.isPending = 1;
+  hsim->reg.startTick = hsim->getTick();
+
+  if (last->plmn[0] == 0) {
+    hsim->reg.strategy = SIM_REG_STRATEGY_AUTO;
+    hsim->reg.stats[SIM_REG_STRATEGY_AUTO].attempts++;
+    return SIM_ReqisterNetwork(hsim);
+  }
+
+  hsim->reg.strategy = SIM_REG_STRATEGY_LAST_OPERATOR;
+  hsim->reg.stats[SIM_REG_STRATEGY_LAST_OPERATOR].attempts++;
+  SIM_Debug("Registering on %s....", last->plmn);
+
+  if (AT_Command(&hsim->atCmd, "+COPS", (paramData[3].value.number < 0)? 3: 4,
+                 paramData, 0, 0) != AT_OK)
+  {
+    // the registration is timed as an automatic one from here
+    hsim->reg.strategy = SIM_REG_STRATEGY_AUTO;
+    hsim->reg.stats[SIM_REG_STRATEGY_AUTO].attempts++;
+    return SIM_ReqisterNetwork(hsim);
+  }
+  return SIM_OK;
+}
+
+
+// registered operator in numeric format
+SIM_Status_t SIM_GetOperator(SIM_HandlerTypeDef *hsim, SIM_Operator_t *op)
+{
+  AT_Data_t paramData[2] = {
+    AT_Number(3),
+    AT_Number(2),
+  };
+  char respstr[8];
+  AT_Data_t respData[4] = {
+    AT_Number(0),
+    AT_Number(0),
+    AT_Buffer(respstr, 8),
+    AT_Number(-1),
+  };
+
+  memset(respstr, 0, 8);
+
+  if (AT_Command(&hsim->atCmd, "+COPS", 2, paramData, 0, 0) != AT_OK) return SIM_ERROR;
+  if (AT_Check(&hsim->atCmd, "+COPS", 4, respData) != AT_OK) return SIM_ERROR;
+  if (respstr[0] == 0) return SIM_ERROR;
+
+  strncpy(op->plmn, respstr, sizeof(op->plmn) - 1);
+  op->plmn[sizeof(op->plmn) - 1] = 0;
+  op->rat = actToRAT(respData[3].value.number);
+  return SIM_OK;
+}
+
+
+// on entering SIM_STATE_ACTIVE, times the selection and saves the operator
+void SIM_OnRegistered(SIM_HandlerTypeDef *hsim)
+{
+  SIM_RegStats_t *stats = &hsim->reg.stats[hsim->reg.strategy];
+  SIM_Operator_t op;
+  uint8_t hasOperator = SIM_GetOperator(hsim, &op) == SIM_OK;
+
+  if (hsim->reg.isPending) {
+    hsim->reg.isPending = 0;
+    stats->registered++;
+    stats->lastTime = hsim->getTick() - hsim->reg.startTick;
+    stats->totalTime += stats->lastTime;
+    if (hsim->reg.strategy == SIM_REG_STRATEGY_LAST_OPERATOR && hasOperator
+        && strcmp(op.plmn, hsim->reg.last.plmn) != 0)
+    {
+      stats->misses++;
+    }
+    SIM_Debug("Registered in %lu ms", (unsigned long) stats->lastTime);
+  }
+
+  if (!hasOperator) return;
+  if (strcmp(op.plmn, hsim->reg.last.plmn) == 0 && op.rat == hsim->reg.last.rat) return;
+
+  memcpy(&hsim->reg.last, &op, sizeof(SIM_Operator_t));
+  if (hsim->reg.onSave != 0) hsim->reg.onSave(&hsim->reg.last);
+}
+
+
+// stored for every boot, applied at once when the modem is up
+SIM_Status_t SIM_SetRadioPreference(SIM_HandlerTypeDef *hsim, const SIM_RadioPref_t *pref)
+{
+  memcpy(&hsim->reg.pref, pref, sizeof(SIM_RadioPref_t));
+  if (hsim->state < SIM_STATE_CHECK_NETWORK) return SIM_OK;
+  return SIM_ApplyRadioPreference(hsim);
+}
+
+
+// writes only what differs, each write makes the modem search again
+SIM_Status_t SIM_ApplyRadioPreference(SIM_HandlerTypeDef *hsim)
+{
+  SIM_RadioPref_t *pref = &hsim->reg.pref;
+  SIM_RadioPref_t cur;
+  uint64_t bands, lteBands;
+  char line[48];
+  AT_Data_t paramData[1] = {
+    AT_Number(0),
+  };
+
+  if (pref->mode == SIM_RADIO_KEEP && pref->order == SIM_RADIO_KEEP &&
+      pref->bands == 0 && pref->lteBands == 0)
+    return SIM_OK;
+
+  if (SIM_GetRadioPreference(hsim, &cur) != SIM_OK) return SIM_ERROR;
+
+  if (pref->mode != SIM_RADIO_KEEP && pref->mode != cur.mode) {
+    SIM_Debug("Scan mode %u -> %u", cur.mode, pref->mode);
+    AT_DataSetNumber(&paramData[0], pref->mode);
+    if (AT_Command(&hsim->atCmd, "+CNMP", 1, paramData, 0, 0) != AT_OK) return SIM_ERROR;
+  }
+
+  if (pref->order != SIM_RADIO_KEEP && pref->order != cur.order) {
+    AT_DataSetNumber(&paramData[0], pref->order);
+    if (AT_Command(&hsim->atCmd, "+CNAOP", 1, paramData, 0, 0) != AT_OK) return SIM_ERROR;
+  }
+
+  bands = pref->bands? pref->bands: cur.bands;
+  lteBands = pref->lteBands? pref->lteBands: cur.lteBands;
+  if (bands != cur.bands || lteBands != cur.lteBands) {
+    // masks go unquoted, and %llX is missing from small printf implementations
+    snprintf(line, sizeof(line), "+CNBP=0x%08lX%08lX,0x%08lX%08lX",
+             (unsigned long) (bands >> 32), (unsigned long) (bands & 0xFFFFFFFFUL),
+             (unsigned long) (lteBands >> 32), (unsigned long) (lteBands & 0xFFFFFFFFUL));
+    if (AT_Command(&hsim->atCmd, line, 0, 0, 0, 0) != AT_OK) return SIM_ERROR;
+  }
+
+  return SIM_OK;
+}
+
+
+// LTE masks wider than 64 bits do not fit and read as all ones
+SIM_Status_t SIM_GetRadioPreference(SIM_HandlerTypeDef *hsim, SIM_RadioPref_t *pref)
+{
+  char bands[24];
+  char lteBands[24];
+  AT_Data_t modeResp[1] = {
+    AT_Number(0),
+  };
+  AT_Data_t orderResp[1] = {
+    AT_Number(0),
+  };
+  AT_Data_t bandResp[2] = {
+    AT_Buffer(bands, sizeof(bands)),
+    AT_Buffer(lteBands, sizeof(lteBands)),
+  };
+
+  memset(bands, 0, sizeof(bands));
+  memset(lteBands, 0, sizeof(lteBands));
+
+  if (AT_Check(&hsim->atCmd, "+CNMP", 1, modeResp) != AT_OK) return SIM_ERROR;
+  if (AT_Check(&hsim->atCmd, "+CNAOP", 1, orderResp) != AT_OK) return SIM_ERROR;
+  if (AT_Check(&hsim->atCmd, "+CNBP", 2, bandResp) != AT_OK) return SIM_ERROR;
+
+  pref->mode = modeResp[0].value.number;
+  pref->order = orderResp[0].value.number;
+  pref->bands = strtoull(bands, 0, 16);
+  pref->lteBands = strtoull(lteBands, 0, 16);
+  return SIM_OK;
+}
+
+
+// access technology the modem is camped on right now
+SIM_Status_t SIM_GetActiveRAT(SIM_HandlerTypeDef *hsim, uint8_t *rat)
+{
+  AT_Data_t respData[2] = {
+    AT_Number(0),
+    AT_Number(0),
+  };
+
+  if (AT_Check(&hsim->atCmd, "+CNSMOD", 2, respData) != AT_OK) return SIM_ERROR;
+
+  switch (respData[1].value.number) {
+  case 1: case 2: case 3:           *rat = SIM_RAT_GSM;     break;
+  case 4: case 5: case 6: case 7:   *rat = SIM_RAT_WCDMA;   break;
+  case 8:                           *rat = SIM_RAT_LTE;     break;
+  default:                          *rat = SIM_RAT_UNKNOWN; break;
+  }
+  return SIM_OK;
+}
+
+
+SIM_Status_t SIM_SetRegistrationURC(SIM_HandlerTypeDef *hsim, uint8_t mode)
+{
+  AT_Data_t paramData[1] = {
+    AT_Number(mode),
+  };
+  SIM_BatchCmd_t cmds[3] = {
+    SIM_BatchCmd("+CREG", 1, paramData),
+    SIM_BatchCmd("+CGREG", 1, paramData),
+    SIM_BatchCmd("+CEREG", 1, paramData),
+  };
+
+  if (SIM_CommandBatch(hsim, cmds, 3) != SIM_OK) return SIM_ERROR;
+
+  if (mode) {
+    SIM_SET_STATUS(hsim, SIM_STATUS_REG_URC_ON);
+  } else {
+    SIM_UNSET_STATUS(hsim, SIM_STATUS_REG_URC_ON);
+  }
+
+  return SIM_OK;
+}
+
+
 SIM_Status_t SIM_GetTime(SIM_HandlerTypeDef *hsim, SIM_Datetime_t *dt)
 {
   uint8_t respstr[24];
@@ -147,9 +505,42 @@ SIM_Status_t SIM_GetTime(SIM_HandlerTypeDef *hsim, SIM_Datetime_t *dt)
 
   if (AT_Check(&hsim->atCmd, "+CCLK",  1, respData) != AT_OK) return SIM_ERROR;
 
-  str2Time(dt, (char*)&respstr[0]);
+  return str2Time(dt, (char*)&respstr[0]);
+}
 
-  return SIM_OK;
+
+// seconds since 1970-01-01 UTC of a modem local time
+uint32_t SIM_DatetimeToEpoch(const SIM_Datetime_t *dt)
+{
+  int32_t local = (int32_t) (daysFromCivil(2000 + dt->year, dt->month, dt->day) * 86400UL
+                             + dt->hour * 3600UL + dt->minute * 60UL + dt->second);
+
+  return (uint32_t) (local - dt->timezone * 900L);
+}
+
+
+// timezone in quarters of an hour like +CCLK, valid up to 2255
+void SIM_EpochToDatetime(uint32_t epoch, int8_t timezone, SIM_Datetime_t *dt)
+{
+  uint32_t local = (uint32_t) ((int64_t) epoch + timezone * 900L);
+  uint32_t secs = local % 86400UL;
+  // civil_from_days of H. Hinnant, days counted from 0000-03-01
+  uint32_t days = local / 86400UL + 719468UL;
+  uint32_t era  = days / 146097UL;
+  uint32_t doe  = days - era * 146097UL;
+  uint32_t yoe  = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+  uint32_t doy  = doe - (365*yoe + yoe/4 - yoe/100);
+  uint32_t mp   = (5*doy + 2) / 153;
+  uint8_t month = (uint8_t) ((mp < 10)? mp + 3: mp - 9);
+  uint32_t year = yoe + era * 400 + (month <= 2);
+
+  dt->year     = (uint8_t) (year - 2000);
+  dt->month    = month;
+  dt->day      = (uint8_t) (doy - (153*mp + 2)/5 + 1);
+  dt->hour     = (uint8_t) (secs / 3600);
+  dt->minute   = (uint8_t) ((secs / 60) % 60);
+  dt->second   = (uint8_t) (secs % 60);
+  dt->timezone = timezone;
 }
 
 
@@ -163,35 +554,430 @@ SIM_Status_t SIM_CheckSugnal(SIM_HandlerTypeDef *hsim)
   if (AT_Command(&hsim->atCmd, "+CSQ", 0, 0, 2, respData) != AT_OK) return SIM_ERROR;
   hsim->signal = respData[1].value.number;
 
+  SIM_SEQ_WRITE_BEGIN(hsim->radioSeq);
+  hsim->radio.rssi = (uint8_t) respData[0].value.number;
+  hsim->radio.ber  = (uint8_t) respData[1].value.number;
+  hsim->radio.tick = hsim->getTick();
+  SIM_SEQ_WRITE_END(hsim->radioSeq);
+
+  return SIM_OK;
+}
+
+
+SIM_Status_t SIM_SetSignalURC(SIM_HandlerTypeDef *hsim, uint8_t enable)
+{
+  uint8_t cmdNb = 1;
+  AT_Data_t paramData[3] = {
+    AT_Number(enable? 1: 0),
+    AT_Number(enable? 1: 0),  // report only when the value changes
+    AT_Number(0),
+  };
+  SIM_BatchCmd_t cmds[2] = {
+    SIM_BatchCmd("+AUTOCSQ", 2, &paramData[0]),
+    SIM_BatchCmd("+CPSI", 1, &paramData[2]),
+  };
+
+#ifdef SIM_SIGNAL_CPSI_INTERVAL
+  AT_DataSetNumber(&paramData[2], enable? SIM_SIGNAL_CPSI_INTERVAL: 0);
+  cmdNb++;
+#endif
+
+  if (SIM_CommandBatch(hsim, cmds, cmdNb) != SIM_OK) return SIM_ERROR;
+
+  if (enable) {
+    SIM_SET_STATUS(hsim, SIM_STATUS_SIGNAL_URC_ON);
+  } else {
+    SIM_UNSET_STATUS(hsim, SIM_STATUS_SIGNAL_URC_ON);
+  }
+
   return SIM_OK;
 }
 
 
-static void str2Time(SIM_Datetime_t *dt, const char *str)
+// returns the last cached metrics without touching the UART
+void SIM_GetRadioMetrics(SIM_HandlerTypeDef *hsim, SIM_RadioMetrics_t *metrics)
 {
-  uint8_t *dtbytes = (uint8_t*) dt;
-  int8_t mult = 1;
-  uint8_t len = (uint8_t) sizeof(SIM_Datetime_t);
-  uint8_t isParsing = 0;
+  uint32_t seq;
+
+  do {
+    seq = hsim->radioSeq;
+    __sync_synchronize();
+    memcpy(metrics, (const void*) &hsim->radio, sizeof(SIM_RadioMetrics_t));
+    __sync_synchronize();
+  } while ((seq & 1) || seq != hsim->radioSeq);
+}
 
-  while (*str && len > 0) {
-    if ((*str > '0' && *str < '9')) {
-      if (!isParsing) {
-        isParsing = 1;
-        *dtbytes = ((int8_t) atoi(str)) * mult;
-        dtbytes++;
-        len--;
-      }
+
+// engineering mode query, same fields as the +CPSI reports
+SIM_Status_t SIM_CheckSystemInfo(SIM_HandlerTypeDef *hsim)
+{
+  char respstr[4][8];
+  char band[16];
+  AT_Data_t respData[14] = {
+    AT_Buffer(respstr[0], 8),
+    AT_Buffer(respstr[1], 8),
+    AT_Buffer(respstr[2], 8),
+    AT_Buffer(respstr[3], 8),
+    AT_Number(0),
+    AT_Number(0),
+    AT_Buffer(band, 16),
+  };
+
+  memset(respstr, 0, sizeof(respstr));
+  memset(band, 0, sizeof(band));
+  for (uint8_t i = 7; i < 14; i++) {
+    AT_DataSetNumber(&respData[i], 0);
+  }
+
+  if (AT_Check(&hsim->atCmd, "+CPSI", 14, respData) != AT_OK) return SIM_ERROR;
+  SIM_OnSystemInfo(hsim, respData);
+
+  return SIM_OK;
+}
+
+
+// last known serving cell, without touching the UART
+void SIM_GetCellInfo(SIM_HandlerTypeDef *hsim, SIM_CellInfo_t *cell)
+{
+  uint32_t seq;
+
+  do {
+    seq = hsim->cellSeq;
+    __sync_synchronize();
+    memcpy(cell, (const void*) &hsim->cell, sizeof(SIM_CellInfo_t));
+    __sync_synchronize();
+  } while ((seq & 1) || seq != hsim->cellSeq);
+}
+
+
+// <stat>,<lac>,<ci>,<AcT> storage for the registration URCs
+AT_Data_t* SIM_NewRegistrationResp(SIM_HandlerTypeDef *hsim)
+{
+  AT_Data_t *resp = SIM_Malloc(hsim, sizeof(AT_Data_t)*4);
+  char *respstr = SIM_Malloc(hsim, SIM_CELL_STR_SIZE*2);
+
+  memset(respstr, 0, SIM_CELL_STR_SIZE*2);
+  AT_DataSetNumber(resp, 0);
+  AT_DataSetBuffer(resp+1, respstr, SIM_CELL_STR_SIZE);
+  AT_DataSetBuffer(resp+2, respstr+SIM_CELL_STR_SIZE, SIM_CELL_STR_SIZE);
+  AT_DataSetNumber(resp+3, -1);
+  return resp;
+}
+
+
+// reg points at <stat>,<lac>,<ci>,<AcT> of a +CREG/+CGREG/+CEREG line,
+// <lac> and <ci> only come with mode 2 and while registered
+void SIM_OnRegistrationCell(SIM_HandlerTypeDef *hsim, AT_Data_t *reg)
+{
+  uint8_t stat = (uint8_t) reg[0].value.number;
+  char *lac = reg[1].value.string;
+  char *ci = reg[2].value.string;
+
+  if ((stat == 1 || stat == 5) && lac[0] != 0 && ci[0] != 0) {
+    SIM_SEQ_WRITE_BEGIN(hsim->cellSeq);
+    hsim->cell.lac = (uint16_t) strtoul(lac, 0, 16);
+    hsim->cell.ci  = (uint32_t) strtoul(ci, 0, 16);
+    if (reg[3].value.number >= 0)
+      hsim->cell.rat = actToRAT(reg[3].value.number);
+    hsim->cell.tick = hsim->getTick();
+    SIM_SEQ_WRITE_END(hsim->cellSeq);
+  }
+
+  // URC storage is reused, the next line may leave these out
+  lac[0] = 0;
+  ci[0] = 0;
+  AT_DataSetNumber(&reg[3], -1);
+}
+
+
+// +CPSI: <mode>,<op mode>,<mcc-mnc>,<tac>,<cell id>,<pcid>,<band>,
+//        <earfcn>,<dlbw>,<ulbw>,<rsrq>,<rsrp>,<rssi>,<rssnr>
+// only the first 5 fields are common to GSM and WCDMA
+void SIM_OnSystemInfo(SIM_HandlerTypeDef *hsim, AT_Data_t *resp)
+{
+  const char *mode = resp[0].value.string;
+  const char *mccmnc = resp[2].value.string;
+  const char *band;
+  uint8_t rat = SIM_RAT_UNKNOWN;
+  uint8_t i = 0;
+
+  if (strncmp(mode, "LTE", 3) == 0)         rat = SIM_RAT_LTE;
+  else if (strncmp(mode, "WCDMA", 5) == 0)  rat = SIM_RAT_WCDMA;
+  else if (strncmp(mode, "GSM", 3) == 0)    rat = SIM_RAT_GSM;
+
+  SIM_SEQ_WRITE_BEGIN(hsim->radioSeq);
+  hsim->radio.rat = rat;
+  if (rat == SIM_RAT_LTE) {
+    hsim->radio.rsrq = (int16_t) resp[10].value.number;
+    hsim->radio.rsrp = (int16_t) resp[11].value.number;
+    hsim->radio.sinr = (int16_t) resp[13].value.number;
+  }
+  hsim->radio.tick = hsim->getTick();
+  SIM_SEQ_WRITE_END(hsim->radioSeq);
+
+  // "NO SERVICE" carries no cell
+  if (rat == SIM_RAT_UNKNOWN) return;
+
+  SIM_SEQ_WRITE_BEGIN(hsim->cellSeq);
+  hsim->cell.rat  = rat;
+  hsim->cell.lac  = (uint16_t) strtoul(resp[3].value.string, 0, 16);
+  hsim->cell.ci   = (uint32_t) resp[4].value.number;
+  hsim->cell.pcid = 0;
+  hsim->cell.band = 0;
+  if (rat == SIM_RAT_LTE) {
+    hsim->cell.pcid = (uint16_t) resp[5].value.number;
+    band = strstr(resp[6].value.string, "BAND");
+    if (band != 0) hsim->cell.band = (uint16_t) atoi(band + 4);
+  }
+  for (; *mccmnc && i < sizeof(hsim->cell.plmn) - 1; mccmnc++) {
+    if (*mccmnc >= '0' && *mccmnc <= '9') hsim->cell.plmn[i++] = *mccmnc;
+  }
+  hsim->cell.plmn[i] = 0;
+  hsim->cell.tick = hsim->getTick();
+  SIM_SEQ_WRITE_END(hsim->cellSeq);
+}
+
+
+// the result of "ATE0" moves the state out of, or back to, CHECK_AT
+static SIM_Status_t checkATResult(SIM_HandlerTypeDef *hsim, SIM_Status_t status)
+{
+  if (status == SIM_OK) {
+    if (hsim->state <= SIM_STATE_CHECK_AT) {
+      SIM_TRACE(hsim, SIM_TRACE_MOD_CORE, hsim->state, SIM_STATE_CHECK_AT+1, SIM_TRACE_CAUSE_OK);
+      hsim->state = SIM_STATE_CHECK_AT+1;
     }
-    else {
-      isParsing = 0;
-      if (*str == '-') {
-        mult = -1;
-      } else {
-        mult = 1;
-      }
+    SIM_SET_STATUS(hsim, SIM_STATUS_ACTIVE);
+  } else {
+    SIM_TRACE(hsim, SIM_TRACE_MOD_CORE, hsim->state, SIM_STATE_CHECK_AT, SIM_TRACE_CAUSE_ERROR);
+    hsim->state = SIM_STATE_CHECK_AT;
+    SIM_UNSET_STATUS(hsim, SIM_STATUS_ACTIVE);
+  }
+
+  return status;
+}
+
+
+// appends cmd to the batch line, returns the new length
+// or -1 when it does not fit or can't be rendered
+static int16_t appendCommand(char *line, uint16_t lineLen, SIM_BatchCmd_t *cmd)
+{
+  int len = lineLen;
+  int n;
+
+  n = snprintf(line+len, SIM_BATCH_LINE_SIZE-len, (len > 0)? ";%s": "%s", cmd->cmd);
+  if (n < 0 || n >= SIM_BATCH_LINE_SIZE-len) goto notFit;
+  len += n;
+
+  for (uint8_t i = 0; i < cmd->paramNb; i++) {
+    const char *sep = (i == 0)? "=": ",";
+
+    if (cmd->params[i].type == AT_NUMBER)
+      n = snprintf(line+len, SIM_BATCH_LINE_SIZE-len, "%s%ld", sep, (long) cmd->params[i].value.number);
+    else if (cmd->params[i].type == AT_STRING)
+      n = snprintf(line+len, SIM_BATCH_LINE_SIZE-len, "%s\"%s\"", sep, cmd->params[i].value.string);
+    else
+      goto notFit;
+
+    if (n < 0 || n >= SIM_BATCH_LINE_SIZE-len) goto notFit;
+    len += n;
+  }
+
+  return (int16_t) len;
+
+notFit:
+  line[lineLen] = 0;
+  return -1;
+}
+
+
+// "yy/MM/dd,hh:mm:ss+zz", zz in quarters of an hour
+static SIM_Status_t str2Time(SIM_Datetime_t *dt, const char *str)
+{
+  uint8_t *fields[6] = {&dt->year, &dt->month, &dt->day, &dt->hour, &dt->minute, &dt->second};
+  uint8_t value;
+  int8_t sign = 1;
+
+  for (uint8_t i = 0; i < 6; i++) {
+    while (*str != 0 && (*str < '0' || *str > '9')) str++;
+    if (*str == 0) return SIM_ERROR;
+
+    value = 0;
+    while (*str >= '0' && *str <= '9') {
+      value = value*10 + (*str - '0');
+      str++;
     }
+    *fields[i] = value;
+  }
+  if (dt->month < 1 || dt->month > 12 || dt->day < 1 || dt->day > 31) return SIM_ERROR;
+
+  dt->timezone = 0;
+  while (*str != 0 && *str != '+' && *str != '-') str++;
+  if (*str == 0) return SIM_OK;
+  if (*str == '-') sign = -1;
+  str++;
 
+  value = 0;
+  while (*str >= '0' && *str <= '9') {
+    value = value*10 + (*str - '0');
     str++;
   }
+  dt->timezone = (int8_t) (sign * value);
+  return SIM_OK;
+}
+
+
+// <AcT> of 3GPP TS 27.007
+static uint8_t actToRAT(int32_t act)
+{
+  switch (act) {
+  case 0: case 1: case 3: case 8:     return SIM_RAT_GSM;
+  case 2: case 4: case 5: case 6:     return SIM_RAT_WCDMA;
+  case 7: case 9:                     return SIM_RAT_LTE;
+  default:                            return SIM_RAT_UNKNOWN;
+  }
+}
+
+
+static int32_t ratToAcT(uint8_t rat)
+{
+  switch (rat) {
+  case SIM_RAT_GSM:   return 0;
+  case SIM_RAT_WCDMA: return 2;
+  case SIM_RAT_LTE:   return 7;
+  default:            return -1;
+  }
+}
+
+
+// days_from_civil of H. Hinnant, days since 1970-01-01
+static uint32_t daysFromCivil(uint16_t year, uint8_t month, uint8_t day)
+{
+  uint32_t y    = year - (month <= 2);
+  uint32_t era  = y / 400;
+  uint32_t yoe  = y - era * 400;
+  uint32_t doy  = (153 * (month > 2? month - 3: month + 9) + 2) / 5 + day - 1;
+  uint32_t doe  = yoe * 365 + yoe/4 - yoe/100 + doy;
+
+  return era * 146097UL + doe - 719468UL;
+}
+
+
+#if SIM_EN_AT_HOOK
+#undef AT_Command
+#undef AT_Check
+#undef AT_CommandWrite
+
+#define GET_HSIM(hat) ((SIM_HandlerTypeDef*)((uint8_t*)(hat) - offsetof(SIM_HandlerTypeDef, atCmd)))
+
+static void enterShared(SIM_HandlerTypeDef *hsim)
+{
+  for (;;) {
+    while (__atomic_load_n(&hsim->atExclusive, __ATOMIC_SEQ_CST)) hsim->delay(1);
+    __atomic_add_fetch(&hsim->atInFlight, 1, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&hsim->atExclusive, __ATOMIC_SEQ_CST)) return;
+    __atomic_sub_fetch(&hsim->atInFlight, 1, __ATOMIC_SEQ_CST);
+  }
+}
+
+static void leaveShared(SIM_HandlerTypeDef *hsim)
+{
+  __atomic_sub_fetch(&hsim->atInFlight, 1, __ATOMIC_SEQ_CST);
+}
+
+// returns the tick the command starts at
+static uint32_t onATStart(SIM_HandlerTypeDef *hsim)
+{
+  enterShared(hsim);
+#if SIM_EN_FEATURE_POWER
+  SIM_PWR_BeginCommand(&hsim->power);
+#endif
+  return hsim->getTick();
+}
+
+static void onATDone(SIM_HandlerTypeDef *hsim, const char *cmd, uint8_t isCheck,
+                     uint32_t startTick, AT_Status_t result)
+{
+#if SIM_EN_FEATURE_STATS
+  SIM_Stats_Record(&hsim->stats, cmd, isCheck, hsim->getTick() - startTick, result);
+#endif
+#if SIM_EN_FEATURE_POWER
+  SIM_PWR_EndCommand(&hsim->power);
+#endif
+#if SIM_EN_FEATURE_WATCHDOG
+  SIM_WDG_OnResult(&hsim->watchdog, result);
+#endif
+  leaveShared(hsim);
+}
+
+AT_Status_t SIM_AT_Command(AT_HandlerTypeDef *hat, const char *cmd,
+                           uint8_t paramNb, AT_Data_t *params,
+                           uint8_t respNb, AT_Data_t *resp)
+{
+  SIM_HandlerTypeDef *hsim = GET_HSIM(hat);
+  uint32_t startTick = onATStart(hsim);
+  AT_Status_t result = AT_Command(hat, cmd, paramNb, params, respNb, resp);
+
+  onATDone(hsim, cmd, 0, startTick, result);
+  return result;
+}
+
+AT_Status_t SIM_AT_Check(AT_HandlerTypeDef *hat, const char *cmd,
+                         uint8_t respNb, AT_Data_t *resp)
+{
+  SIM_HandlerTypeDef *hsim = GET_HSIM(hat);
+  uint32_t startTick = onATStart(hsim);
+  AT_Status_t result = AT_Check(hat, cmd, respNb, resp);
+
+  onATDone(hsim, cmd, 1, startTick, result);
+  return result;
+}
+
+AT_Status_t SIM_AT_CommandWrite(AT_HandlerTypeDef *hat, const char *cmd, const char *prompt,
+                                const uint8_t *data, uint16_t length,
+                                uint8_t paramNb, AT_Data_t *params,
+                                uint8_t respNb, AT_Data_t *resp)
+{
+  SIM_HandlerTypeDef *hsim = GET_HSIM(hat);
+  uint32_t startTick = onATStart(hsim);
+  AT_Status_t result = AT_CommandWrite(hat, cmd, prompt, data, length,
+                                       paramNb, params, respNb, resp);
+
+  onATDone(hsim, cmd, 0, startTick, result);
+  return result;
+}
+
+// the timeout of the AT handler is shared, so the other library commands
+// wait until this one is done instead of running with it
+AT_Status_t SIM_AT_CommandTimeout(AT_HandlerTypeDef *hat, const char *cmd, uint32_t timeout)
+{
+  SIM_HandlerTypeDef *hsim = GET_HSIM(hat);
+  uint32_t defaultTimeout;
+  uint32_t startTick;
+  AT_Status_t result;
+  uint8_t expected = 0;
+
+  while (!__atomic_compare_exchange_n(&hsim->atExclusive, &expected, 1,
+                                      0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+  {
+    expected = 0;
+    hsim->delay(1);
+  }
+  while (__atomic_load_n(&hsim->atInFlight, __ATOMIC_SEQ_CST) != 0) hsim->delay(1);
+
+  // counted as in flight like any other, the gate is already held
+  __atomic_add_fetch(&hsim->atInFlight, 1, __ATOMIC_SEQ_CST);
+#if SIM_EN_FEATURE_POWER
+  SIM_PWR_BeginCommand(&hsim->power);
+#endif
+  startTick = hsim->getTick();
+
+  defaultTimeout = hat->config.timeout;
+  hat->config.timeout = timeout;
+  result = AT_Command(hat, cmd, 0, 0, 0, 0);
+  hat->config.timeout = defaultTimeout;
+
+  onATDone(hsim, cmd, 0, startTick, result);
+  __atomic_store_n(&hsim->atExclusive, 0, __ATOMIC_SEQ_CST);
+  return result;
 }
+#endif /* SIM_EN_AT_HOOK */
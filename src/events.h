@@ -22,11 +22,24 @@
 #define SIM_RTOS_EVT_NTP_SYNCED         0x0800U
 // ntp
 #define SIM_RTOS_EVT_HTTP_NEW_STATE     0x1000U
+#define SIM_RTOS_EVT_HTTP_ASYNC         0x4000U
+#define SIM_RTOS_EVT_HTTP_RELEASED      0x20000U
+// at command queue
+#define SIM_RTOS_EVT_ATQ_NEW_CMD        0x2000U
+// power
+#define SIM_RTOS_EVT_PWR_WAKE           0x8000U
+// watchdog
+#define SIM_RTOS_EVT_WDG                0x10000U
+
+// event of SIM_Group_t, the instance events are kept in hsim->pendingEvents
+#define SIM_GROUP_EVT_WAKEUP            0x0001U
 
 #define SIM_RTOS_AVT_ALL  SIM_RTOS_EVT_READY | SIM_RTOS_EVT_NEW_STATE | SIM_RTOS_EVT_ACTIVED |\
                           SIM_RTOS_EVT_GPS_NEW_STATE | SIM_RTOS_EVT_NET_NEW_STATE |\
                           SIM_RTOS_EVT_SOCKMGR_NEW_STATE | SIM_RTOS_EVT_SOCKCLIENT_NEW_EVT |\
-                          SIM_RTOS_EVT_NTP_SYNCED
+                          SIM_RTOS_EVT_NTP_SYNCED | SIM_RTOS_EVT_ATQ_NEW_CMD |\
+                          SIM_RTOS_EVT_HTTP_ASYNC | SIM_RTOS_EVT_PWR_WAKE |\
+                          SIM_RTOS_EVT_WDG
 
 
 
@@ -10,13 +10,24 @@
 #include "simcom/gps.h"
 #include "simcom/file.h"
 #include "simcom/socket.h"
+#include "simcom/stats.h"
+#include "simcom/atqueue.h"
+#include "simcom/memory.h"
+#include "simcom/trace.h"
+#include "simcom/power.h"
+#include "simcom/watchdog.h"
+#include "simcom/clock.h"
+#include "simcom/usage.h"
 #include <at-command.h>
 
 #define SIM_STATUS_ACTIVE           0x01
+#define SIM_STATUS_REG_URC_ON       0x02
+#define SIM_STATUS_SIGNAL_URC_ON    0x04
 #define SIM_STATUS_ROAMING          0x08
 #define SIM_STATUS_UART_READING     0x10
 #define SIM_STATUS_UART_WRITING     0x20
 #define SIM_STATUS_CMD_RUNNING      0x40
+#define SIM_STATUS_HOTSWAP_ON       0x80
 
 enum {
  SIM_STATE_NON_ACTIVE,
@@ -27,6 +38,8 @@ enum {
 };
 
 
+struct SIM_Group;
+
 typedef struct SIM_HandlerTypeDef {
   uint32_t            key;
   AT_HandlerTypeDef   atCmd;
@@ -38,10 +51,33 @@ typedef struct SIM_HandlerTypeDef {
 
   uint8_t             signal;
 
+  SIM_RadioMetrics_t  radio;
+  volatile uint32_t   radioSeq;
+
+  SIM_CellInfo_t      cell;
+  volatile uint32_t   cellSeq;
+
+  SIM_BootTiming_t    bootTiming;
+  uint16_t            probeInterval;
+
+  struct {
+    SIM_Operator_t  last;
+    uint8_t         strategy;     // of the selection in progress
+    uint8_t         isPending;
+    uint32_t        startTick;
+    SIM_RegStats_t  stats[SIM_REG_STRATEGY_NB];
+    SIM_RadioPref_t pref;
+
+    // called when the registered operator changed, to store it in NVM
+    void (*onSave)(const SIM_Operator_t*);
+  } reg;
+
   struct {
     uint32_t init;
     uint32_t changedState;
     uint32_t checksignal;
+    uint32_t checkcell;
+    uint32_t nextDeadline;  // earliest tick a loop has to run again
   } tick;
 
 
@@ -65,6 +101,19 @@ typedef struct SIM_HandlerTypeDef {
 
   uint8_t network_status;
 
+  uint8_t simcard;  // SIM_CardStatus_t
+  void (*onSIMCard)(uint8_t status);
+
+  // set when the instance is served by SIM_Thread_RunGroup
+  struct SIM_Group    *group;
+  volatile uint32_t   pendingEvents;
+
+  #if SIM_EN_AT_HOOK
+  // library commands hold off while one runs alone with its own timeout
+  volatile uint8_t    atExclusive;
+  volatile uint8_t    atInFlight;
+  #endif
+
   #if SIM_EN_FEATURE_NET
   SIM_NET_HandlerTypeDef net;
   #endif /* SIM_EN_FEATURE_NET */
@@ -89,21 +138,80 @@ typedef struct SIM_HandlerTypeDef {
   SIM_FILE_HandlerTypeDef file;
   #endif
 
+  #if SIM_EN_FEATURE_STATS
+  SIM_Stats_HandlerTypeDef stats;
+  #endif
+
+  #if SIM_EN_FEATURE_ATQUEUE
+  SIM_ATQ_HandlerTypeDef atq;
+  #endif
+
+  #if SIM_EN_FEATURE_TRACE
+  SIM_Trace_HandlerTypeDef trace;
+  #endif
+
+  #if SIM_EN_FEATURE_POWER
+  SIM_PWR_HandlerTypeDef power;
+  #endif
+
+  #if SIM_EN_FEATURE_WATCHDOG
+  SIM_WDG_HandlerTypeDef watchdog;
+  #endif
+
+  #if SIM_EN_FEATURE_CLOCK
+  SIM_Clock_HandlerTypeDef clock;
+  #endif
+
+  #if SIM_EN_FEATURE_USAGE
+  SIM_Usage_HandlerTypeDef usage;
+  #endif
+
+  #if SIM_EN_STATIC_ALLOC
+  void     *memPool[SIM_MEM_POOL_SIZE / sizeof(void*) + 1];
+  uint16_t memPoolUsed;
+  #endif
+
   // Buffers
+  #if SIM_RESP_BUFFER_SIZE > 0
   uint8_t  respBuffer[SIM_RESP_BUFFER_SIZE];
   uint16_t respBufferLen;
+  #endif
 
+  #if SIM_CMD_BUFFER_SIZE > 0
   char     cmdBuffer[SIM_CMD_BUFFER_SIZE];
   uint16_t cmdBufferLen;
+  #endif
 } SIM_HandlerTypeDef;
 
 
+/*
+ * Several modems served by one thread. Every instance still needs its own
+ * rtos/serial callbacks for its AT handler (SIM_Thread_ATCHandler keeps one
+ * thread per modem), the SIM layer events of the instances are collected in
+ * hsim->pendingEvents and the group is woken through its own event object.
+ */
+typedef struct SIM_Group {
+  SIM_HandlerTypeDef  *instances[SIM_GROUP_MAX_INSTANCES];
+  uint8_t             instancesNb;
+
+  void        *context;
+  AT_Status_t (*eventSet)(void *context, uint32_t events);
+  AT_Status_t (*eventWait)(void *context, uint32_t waitEvents, uint32_t *onEvents, uint32_t timeout);
+} SIM_Group_t;
+
+
 SIM_Status_t SIM_Init(SIM_HandlerTypeDef*);
+SIM_Status_t SIM_Group_Add(SIM_Group_t*, SIM_HandlerTypeDef*);
 
 // Threads
 void SIM_Thread_Run(SIM_HandlerTypeDef*);
+void SIM_Thread_RunGroup(SIM_Group_t*);
 void SIM_Thread_ATCHandler(SIM_HandlerTypeDef*);
 
 void SIM_SetState(SIM_HandlerTypeDef*, uint8_t newState);
+void SIM_EventSet(SIM_HandlerTypeDef*, uint32_t events);
+
+// Scheduler
+uint8_t SIM_CheckTimeout(SIM_HandlerTypeDef*, uint32_t lastTick, uint32_t timeout);
 
 #endif /* SIMCOM_7600E_H */
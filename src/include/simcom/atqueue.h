@@ -0,0 +1,63 @@
+/*
+ * atqueue.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ */
+
+#ifndef SIMCOM_7600E_ATQUEUE_H_
+#define SIMCOM_7600E_ATQUEUE_H_
+
+#include "conf.h"
+#if SIM_EN_FEATURE_ATQUEUE
+
+#include "types.h"
+#include <at-command.h>
+
+enum {
+  SIM_ATQ_PRIO_DATA,            // socket and http payload
+  SIM_ATQ_PRIO_CONTROL,         // open, close, configuration
+  SIM_ATQ_PRIO_HOUSEKEEPING,    // polls, deferred while data is flowing
+  SIM_ATQ_NUM_OF_PRIO,
+};
+
+// owned by the caller until onComplete is called
+typedef struct SIM_ATQ_Cmd {
+  struct SIM_ATQ_Cmd *next;
+  uint8_t       priority;
+
+  const char    *cmd;
+  uint8_t       paramNb;
+  AT_Data_t     params[SIM_ATQ_MAX_PARAMS];
+  uint8_t       respNb;
+  AT_Data_t     *resp;
+  const uint8_t *data;          // optional, written after the ">" prompt
+  uint16_t      dataLen;
+
+  SIM_Status_t  status;
+  void          *context;
+  void (*onComplete)(struct SIM_ATQ_Cmd*);
+
+  // library side, runs right before onComplete
+  void          *owner;
+  void (*onDone)(struct SIM_ATQ_Cmd*);
+} SIM_ATQ_Cmd_t;
+
+typedef struct {
+  void              *hsim;
+  SIM_ATQ_Cmd_t     *submitted;                  // pushed by any thread
+  SIM_ATQ_Cmd_t     *head[SIM_ATQ_NUM_OF_PRIO];  // FIFOs of the SIM thread
+  SIM_ATQ_Cmd_t     *tail[SIM_ATQ_NUM_OF_PRIO];
+  volatile uint32_t dataTick;
+} SIM_ATQ_HandlerTypeDef;
+
+SIM_Status_t SIM_ATQ_Init(SIM_ATQ_HandlerTypeDef*, void *hsim);
+SIM_Status_t SIM_ATQ_Submit(SIM_ATQ_HandlerTypeDef*, SIM_ATQ_Cmd_t*);
+SIM_Status_t SIM_ATQ_SubmitHooked(SIM_ATQ_HandlerTypeDef*, SIM_ATQ_Cmd_t*,
+                                  void (*onDone)(SIM_ATQ_Cmd_t*), void *owner);
+void         SIM_ATQ_Process(SIM_ATQ_HandlerTypeDef*);
+void         SIM_ATQ_MarkData(SIM_ATQ_HandlerTypeDef*);
+uint8_t      SIM_ATQ_IsDataFlowing(SIM_ATQ_HandlerTypeDef*);
+
+#endif /* SIM_EN_FEATURE_ATQUEUE */
+#endif /* SIMCOM_7600E_ATQUEUE_H_ */
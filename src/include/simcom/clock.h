@@ -0,0 +1,56 @@
+/*
+ * clock.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ */
+
+#ifndef SIMCOM_7600E_CLOCK_H_
+#define SIMCOM_7600E_CLOCK_H_
+
+#include "conf.h"
+#if SIM_EN_FEATURE_CLOCK
+
+#include "types.h"
+
+#define SIM_CLOCK_NUM_OF_SAMPLES  4   // syncs the drift is measured across
+
+// network time at a getTick(), errMs is the half width of the window it fell in
+typedef struct {
+  uint32_t  tick;
+  uint16_t  errMs;
+  uint64_t  epochMs;
+} SIM_Clock_Sample_t;
+
+// network time anchored to getTick(), read without AT traffic
+typedef struct {
+  void              *hsim;
+  volatile uint32_t seq;
+  uint8_t           isSynced;
+  int8_t            timezone;       // quarters of an hour, as reported by +CCLK
+  int32_t           drift;          // ppb network time runs ahead of getTick()
+  uint64_t          epochMs;        // ms since 1970-01-01 UTC at syncTick
+  uint32_t          syncTick;
+  uint32_t          lastSync;       // getTick() of the last +CCLK query
+  uint8_t           isRetrying;     // that query failed, the next comes sooner
+  uint32_t          resyncInterval; // grows while the drift predicts the syncs well
+
+  uint8_t             numOfSamples;
+  SIM_Clock_Sample_t  samples[SIM_CLOCK_NUM_OF_SAMPLES];   // oldest first
+} SIM_Clock_HandlerTypeDef;
+
+SIM_Status_t SIM_Clock_Init(SIM_Clock_HandlerTypeDef*, void *hsim);
+SIM_Status_t SIM_Clock_Sync(SIM_Clock_HandlerTypeDef*);
+void         SIM_Clock_Set(SIM_Clock_HandlerTypeDef*, uint64_t epochMs, int8_t timezone,
+                           uint32_t tick, uint16_t errMs);
+void         SIM_Clock_Loop(SIM_Clock_HandlerTypeDef*);
+
+uint8_t      SIM_Clock_IsSynced(SIM_Clock_HandlerTypeDef*);
+uint32_t     SIM_Clock_GetResyncInterval(SIM_Clock_HandlerTypeDef*);
+int32_t      SIM_Clock_GetDrift(SIM_Clock_HandlerTypeDef*);
+SIM_Status_t SIM_Clock_GetEpoch(SIM_Clock_HandlerTypeDef*, uint32_t *epoch);
+SIM_Status_t SIM_Clock_GetEpochMs(SIM_Clock_HandlerTypeDef*, uint64_t *epochMs);
+SIM_Status_t SIM_Clock_GetDatetime(SIM_Clock_HandlerTypeDef*, SIM_Datetime_t*);
+
+#endif /* SIM_EN_FEATURE_CLOCK */
+#endif /* SIMCOM_7600E_CLOCK_H_ */
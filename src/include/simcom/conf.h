@@ -32,10 +32,61 @@
 #define SIM_EN_FEATURE_GPS 0
 #endif
 
+// PDP contexts configured with SIM_NET_SetupPDP, brought up together
+#ifndef SIM_NET_PDP_NUM
+#define SIM_NET_PDP_NUM     1
+#endif
+
+// context of SIM_NET_SetupAPN and of sockets/requests without a cid
+#ifndef SIM_NET_DEFAULT_CID
+#define SIM_NET_DEFAULT_CID 1
+#endif
+
+#ifndef SIM_NET_PDP_RETRY_INTERVAL
+#define SIM_NET_PDP_RETRY_INTERVAL 10000
+#endif
+
 #ifndef SIM_NUM_OF_SOCKET
 #define SIM_NUM_OF_SOCKET  10
 #endif
 
+// socket events waiting for the SIM thread, power of 2
+#ifndef SIM_SOCK_EVENT_QUEUE_SIZE
+#define SIM_SOCK_EVENT_QUEUE_SIZE  16
+#endif
+
+#ifndef SIM_EN_FEATURE_STATS
+#define SIM_EN_FEATURE_STATS 0
+#endif
+
+#ifndef SIM_EN_FEATURE_ATQUEUE
+#define SIM_EN_FEATURE_ATQUEUE 0
+#endif
+
+#ifndef SIM_EN_FEATURE_TRACE
+#define SIM_EN_FEATURE_TRACE 0
+#endif
+
+#ifndef SIM_EN_FEATURE_POWER
+#define SIM_EN_FEATURE_POWER 0
+#endif
+
+#ifndef SIM_EN_FEATURE_WATCHDOG
+#define SIM_EN_FEATURE_WATCHDOG 0
+#endif
+
+#ifndef SIM_EN_FEATURE_CLOCK
+#define SIM_EN_FEATURE_CLOCK 0
+#endif
+
+// byte counters per socket, per http and per PDP context, needs SIM_EN_FEATURE_NET
+#ifndef SIM_EN_FEATURE_USAGE
+#define SIM_EN_FEATURE_USAGE 0
+#endif
+
+// library AT calls go through the hooks in core.c
+#define SIM_EN_AT_HOOK (SIM_EN_FEATURE_STATS || SIM_EN_FEATURE_POWER || SIM_EN_FEATURE_WATCHDOG)
+
 #ifndef SIM_EN_FEATURE_FILE
 #define SIM_EN_FEATURE_FILE SIM_EN_FEATURE_HTTP
 #endif
@@ -44,13 +95,107 @@
 #define SIM_DEBUG 1
 #endif
 
+// take all library storage from a pool inside the handler instead of the heap
+#ifndef SIM_EN_STATIC_ALLOC
+#define SIM_EN_STATIC_ALLOC 0
+#endif
+
+// fails the build when the handler is larger, 0 disables the check
+#ifndef SIM_RAM_BUDGET
+#define SIM_RAM_BUDGET 0
+#endif
+
+// legacy buffers of the handler, not used by the library
 #ifndef SIM_CMD_BUFFER_SIZE
+#if SIM_EN_STATIC_ALLOC
+#define SIM_CMD_BUFFER_SIZE  0
+#else
 #define SIM_CMD_BUFFER_SIZE  256
 #endif
+#endif
 
 #ifndef SIM_RESP_BUFFER_SIZE
+#if SIM_EN_STATIC_ALLOC
+#define SIM_RESP_BUFFER_SIZE  0
+#else
 #define SIM_RESP_BUFFER_SIZE  256
 #endif
+#endif
+
+// longest command line SIM_CommandBatch joins commands into
+#ifndef SIM_BATCH_LINE_SIZE
+#define SIM_BATCH_LINE_SIZE   128
+#endif
+
+// AT probing during bring-up: timeout of a probe and backoff between probes
+#ifndef SIM_BOOT_PROBE_TIMEOUT
+#define SIM_BOOT_PROBE_TIMEOUT  300
+#endif
+
+#ifndef SIM_BOOT_PROBE_MIN
+#define SIM_BOOT_PROBE_MIN      100
+#endif
+
+#ifndef SIM_BOOT_PROBE_MAX
+#define SIM_BOOT_PROBE_MAX      2000
+#endif
+
+// track the SIM card with +CPIN/+SIMCARD URCs instead of polling +CPIN?
+#ifndef SIM_EN_URC_SIMCARD
+#define SIM_EN_URC_SIMCARD 0
+#endif
+
+#if SIM_EN_URC_SIMCARD
+#ifndef SIM_SIMCARD_FALLBACK_INTERVAL
+#define SIM_SIMCARD_FALLBACK_INTERVAL 30000
+#endif
+
+// sends +UIMHOTSWAPON=1 so removing the card is reported with +SIMCARD,
+// needs the detect pin of the SIM holder wired to the modem
+#ifndef SIM_SIMCARD_HOTSWAP
+#define SIM_SIMCARD_HOTSWAP 0
+#endif
+#endif /* SIM_EN_URC_SIMCARD */
+
+// track CS/PS registration with +CREG/+CGREG/+CEREG URCs instead of polling
+#ifndef SIM_EN_URC_REGISTRATION
+#define SIM_EN_URC_REGISTRATION 0
+#endif
+
+#if SIM_EN_URC_REGISTRATION
+#ifndef SIM_REG_FALLBACK_INTERVAL
+#define SIM_REG_FALLBACK_INTERVAL 30000
+#endif
+#endif /* SIM_EN_URC_REGISTRATION */
+
+// how long +COPS=4 on the last operator may run before +COPS=0 is sent
+#ifndef SIM_REG_LAST_OPERATOR_TIMEOUT
+#define SIM_REG_LAST_OPERATOR_TIMEOUT 60000
+#endif
+
+// cache signal metrics from +CSQ/+CPSI URCs instead of polling +CSQ
+#ifndef SIM_EN_URC_SIGNAL
+#define SIM_EN_URC_SIGNAL 0
+#endif
+
+// ms between +CPSI? queries refreshing the serving cell, leave undefined
+// when the +CPSI reports of SIM_EN_URC_SIGNAL are enough
+// #define SIM_CELL_INFO_INTERVAL 60000
+
+#if SIM_EN_URC_SIGNAL
+#ifndef SIM_SIGNAL_CPSI_INTERVAL
+#define SIM_SIGNAL_CPSI_INTERVAL 10   // seconds, 0 disables +CPSI reports
+#endif
+#endif /* SIM_EN_URC_SIGNAL */
+
+#ifndef SIM_GROUP_MAX_INSTANCES
+#define SIM_GROUP_MAX_INSTANCES 2
+#endif
+
+// longest time SIM_Thread_Run sleeps when no deadline was registered
+#ifndef SIM_SCHED_MAX_IDLE
+#define SIM_SCHED_MAX_IDLE  60000
+#endif
 
 #if SIM_EN_FEATURE_NTP
 #ifndef SIM_NTP_SYNC_DELAY_TIMEOUT
@@ -58,6 +203,115 @@
 #endif
 #endif
 
+#if SIM_EN_FEATURE_STATS
+#ifndef SIM_STATS_NUM_OF_CMD
+#define SIM_STATS_NUM_OF_CMD  24
+#endif
+#endif /* SIM_EN_FEATURE_STATS */
+
+#if SIM_EN_FEATURE_ATQUEUE
+#ifndef SIM_ATQ_MAX_PARAMS
+#define SIM_ATQ_MAX_PARAMS      4
+#endif
+
+// housekeeping commands wait until no data was sent for this long
+#ifndef SIM_ATQ_DATA_IDLE_TIME
+#define SIM_ATQ_DATA_IDLE_TIME  1000
+#endif
+#endif /* SIM_EN_FEATURE_ATQUEUE */
+
+#if SIM_EN_FEATURE_TRACE
+// records of the state transition trace, power of 2
+#ifndef SIM_TRACE_SIZE
+#define SIM_TRACE_SIZE  64
+#endif
+#endif /* SIM_EN_FEATURE_TRACE */
+
+#if SIM_EN_FEATURE_POWER
+// ms the UART needs after DTR is pulled low
+#ifndef SIM_PWR_WAKE_DELAY
+#define SIM_PWR_WAKE_DELAY      50
+#endif
+
+// ms the modem needs after the wakeup pulse to leave PSM
+#ifndef SIM_PWR_PSM_WAKE_DELAY
+#define SIM_PWR_PSM_WAKE_DELAY  1000
+#endif
+
+// URC reporting "ENTER PSM" and "EXIT PSM"
+#ifndef SIM_PWR_PSM_URC
+#define SIM_PWR_PSM_URC         "+CPSMSTATUS"
+#endif
+#endif /* SIM_EN_FEATURE_POWER */
+
+#if SIM_EN_FEATURE_WATCHDOG
+// consecutive AT timeouts taken as a stuck channel
+#ifndef SIM_WDG_MAX_TIMEOUTS
+#define SIM_WDG_MAX_TIMEOUTS    3
+#endif
+
+// timeout of the probes confirming a stuck channel
+#ifndef SIM_WDG_PROBE_TIMEOUT
+#define SIM_WDG_PROBE_TIMEOUT   1000
+#endif
+
+// wait for "RDY" after +CFUN=1,1 and after the hardReset hook
+#ifndef SIM_WDG_SOFT_TIMEOUT
+#define SIM_WDG_SOFT_TIMEOUT    30000
+#endif
+
+#ifndef SIM_WDG_HARD_TIMEOUT
+#define SIM_WDG_HARD_TIMEOUT    60000
+#endif
+
+// longest wait for the network and sockets after the modem is back
+#ifndef SIM_WDG_RESTORE_TIMEOUT
+#define SIM_WDG_RESTORE_TIMEOUT 180000
+#endif
+#endif /* SIM_EN_FEATURE_WATCHDOG */
+
+#if SIM_EN_FEATURE_CLOCK
+// +CCLK years below this are the modem default, not network time
+#ifndef SIM_CLOCK_MIN_YEAR
+#define SIM_CLOCK_MIN_YEAR        24
+#endif
+
+#ifndef SIM_CLOCK_RETRY_INTERVAL
+#define SIM_CLOCK_RETRY_INTERVAL  10000
+#endif
+
+// re-anchors against the modem RTC, or NTP once a server is set; the
+// interval doubles while the drift-corrected clock stays within
+// SIM_CLOCK_TARGET_ERROR ms at each sync, up to the max
+#ifndef SIM_CLOCK_RESYNC_INTERVAL
+#define SIM_CLOCK_RESYNC_INTERVAL 3600000
+#endif
+
+#ifndef SIM_CLOCK_MAX_RESYNC_INTERVAL
+#define SIM_CLOCK_MAX_RESYNC_INTERVAL 86400000
+#endif
+
+#ifndef SIM_CLOCK_TARGET_ERROR
+#define SIM_CLOCK_TARGET_ERROR    100
+#endif
+
+// longest wait for the next +CCLK second on a sync, 0 keeps 1 s resolution
+#ifndef SIM_CLOCK_EDGE_TIMEOUT
+#define SIM_CLOCK_EDGE_TIMEOUT    1200
+#endif
+#endif /* SIM_EN_FEATURE_CLOCK */
+
+#if SIM_EN_FEATURE_USAGE
+// query of the modem data counters of a context, sent as <cmd>=<cid> and
+// answered with "<cmd>: <cid>,<sent bytes>,<received bytes>"; the command
+// differs between firmwares, leave undefined to count in the library only
+// #define SIM_USAGE_MODEM_CMD "+..."
+
+#ifndef SIM_USAGE_MODEM_INTERVAL
+#define SIM_USAGE_MODEM_INTERVAL  300000
+#endif
+#endif /* SIM_EN_FEATURE_USAGE */
+
 #ifndef LWGPS_IGNORE_USER_OPTS
 #define LWGPS_IGNORE_USER_OPTS
 #endif
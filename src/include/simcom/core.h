@@ -10,12 +10,46 @@
 
 #include "../simcom.h"
 
+typedef struct {
+  const char    *cmd;
+  uint8_t       paramNb;
+  AT_Data_t     *params;
+  SIM_Status_t  status;     // result of this command, set by SIM_CommandBatch
+} SIM_BatchCmd_t;
+
+#define SIM_BatchCmd(c, n, p) {.cmd = (c), .paramNb = (n), .params = (p), .status = SIM_ERROR}
+
+SIM_Status_t SIM_CommandBatch(SIM_HandlerTypeDef*, SIM_BatchCmd_t *cmds, uint8_t cmdNb);
 SIM_Status_t SIM_Echo(SIM_HandlerTypeDef*, uint8_t onoff);
 SIM_Status_t SIM_CheckAT(SIM_HandlerTypeDef*);
+SIM_Status_t SIM_ProbeAT(SIM_HandlerTypeDef*, uint32_t timeout);
 SIM_Status_t SIM_CheckSIMCard(SIM_HandlerTypeDef*);
+uint8_t      SIM_ParseSIMCard(const char *status);
+void         SIM_UpdateSIMCard(SIM_HandlerTypeDef*, uint8_t status);
+SIM_Status_t SIM_SetSIMCardHotSwap(SIM_HandlerTypeDef*, uint8_t enable);
 SIM_Status_t SIM_CheckNetwork(SIM_HandlerTypeDef*);
 SIM_Status_t SIM_ReqisterNetwork(SIM_HandlerTypeDef*);
+SIM_Status_t SIM_SetRegistrationURC(SIM_HandlerTypeDef*, uint8_t mode);
+void         SIM_SetLastOperator(SIM_HandlerTypeDef*, const SIM_Operator_t*);
+SIM_Status_t SIM_SelectOperator(SIM_HandlerTypeDef*);
+SIM_Status_t SIM_GetOperator(SIM_HandlerTypeDef*, SIM_Operator_t*);
+void         SIM_OnRegistered(SIM_HandlerTypeDef*);
+SIM_Status_t SIM_SetRadioPreference(SIM_HandlerTypeDef*, const SIM_RadioPref_t*);
+SIM_Status_t SIM_ApplyRadioPreference(SIM_HandlerTypeDef*);
+SIM_Status_t SIM_GetRadioPreference(SIM_HandlerTypeDef*, SIM_RadioPref_t*);
+SIM_Status_t SIM_GetActiveRAT(SIM_HandlerTypeDef*, uint8_t *rat);
 SIM_Status_t SIM_GetTime(SIM_HandlerTypeDef*, SIM_Datetime_t*);
+uint32_t     SIM_DatetimeToEpoch(const SIM_Datetime_t*);
+void         SIM_EpochToDatetime(uint32_t epoch, int8_t timezone, SIM_Datetime_t*);
 SIM_Status_t SIM_CheckSugnal(SIM_HandlerTypeDef*);
+SIM_Status_t SIM_SetSignalURC(SIM_HandlerTypeDef*, uint8_t enable);
+void         SIM_GetRadioMetrics(SIM_HandlerTypeDef*, SIM_RadioMetrics_t*);
+SIM_Status_t SIM_CheckSystemInfo(SIM_HandlerTypeDef*);
+void         SIM_GetCellInfo(SIM_HandlerTypeDef*, SIM_CellInfo_t*);
+
+// cell cache, fed by the +CREG/+CGREG/+CEREG and +CPSI handlers
+AT_Data_t*   SIM_NewRegistrationResp(SIM_HandlerTypeDef*);
+void         SIM_OnRegistrationCell(SIM_HandlerTypeDef*, AT_Data_t *reg);
+void         SIM_OnSystemInfo(SIM_HandlerTypeDef*, AT_Data_t *resp);
 
 #endif /* SIMCOM_7600E_CORE_H */
@@ -76,6 +76,7 @@ typedef struct SIM_GPS_HandlerTypeDef {
   uint8_t           isConfigured;
   SIM_GPS_Config_t  config;
   lwgps_t           lwgps;
+  volatile uint32_t nmeaLines;      // sentences passed to lwgps
 } SIM_GPS_HandlerTypeDef;
 
 SIM_Status_t SIM_GPS_Init(SIM_GPS_HandlerTypeDef*, void *hsim);
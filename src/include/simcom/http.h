@@ -28,6 +28,7 @@ typedef struct {
   uint8_t       method;
   const uint8_t *httpData;       // header + content
   uint16_t      httpDataLength;
+  uint8_t       cid;            // PDP context, 0 for SIM_NET_DEFAULT_CID
 } SIM_HTTP_Request_t;
 
 typedef struct {
@@ -45,6 +46,25 @@ typedef struct {
   uint16_t contentLen;
 } SIM_HTTP_Response_t;
 
+// handle of a non-blocking request, owned by the caller until onComplete;
+// callbacks are called from the SIM thread
+typedef struct SIM_HTTP_Async {
+  struct SIM_HTTP_Async *next;
+
+  // set by user
+  SIM_HTTP_Request_t  req;
+  SIM_HTTP_Response_t resp;         // buffers as in the blocking api
+  uint32_t            timeout;      // max wait for each modem response
+  void                *context;
+  void (*onStatus)(struct SIM_HTTP_Async*, uint16_t code, uint16_t contentLen);
+  void (*onHead)(struct SIM_HTTP_Async*, const void *head, uint16_t len);
+  void (*onData)(struct SIM_HTTP_Async*, const void *data, uint16_t len);
+  void (*onComplete)(struct SIM_HTTP_Async*, SIM_Status_t);
+
+  // set by simcom
+  SIM_Status_t        status;
+} SIM_HTTP_Async_t;
+
 
 typedef struct {
   void      *hsim;
@@ -55,8 +75,15 @@ typedef struct {
   uint16_t contentBufLen;        // length of buffer which is available to handle
   uint16_t contentReadLen;
 
+  uint16_t headLen;
+
   SIM_HTTP_Request_t  *request;
   SIM_HTTP_Response_t *response;
+
+  SIM_HTTP_Async_t    *submitted;   // pushed by any thread
+  SIM_HTTP_Async_t    *asyncHead;   // queue of the SIM thread
+  SIM_HTTP_Async_t    *asyncTail;
+  SIM_HTTP_Async_t    *current;
 } SIM_HTTP_HandlerTypeDef;
 
 
@@ -68,5 +95,8 @@ SIM_Status_t SIM_HTTP_SendRequest(SIM_HTTP_HandlerTypeDef *hsimHttp, char *url,
                                   uint16_t httpRequestLength,
                                   SIM_HTTP_Response_t *resp,
                                   uint32_t timeout);
+SIM_Status_t SIM_HTTP_RequestAsync(SIM_HTTP_HandlerTypeDef*, SIM_HTTP_Async_t*);
+void SIM_HTTP_OnNewState(SIM_HTTP_HandlerTypeDef*);
+void SIM_HTTP_Loop(SIM_HTTP_HandlerTypeDef*);
 #endif /* SIM_EN_FEATURE_HTTP */
 #endif /* SIMCOM_7600E_HTTP_H_ */
@@ -0,0 +1,50 @@
+/*
+ * memory.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ */
+
+#ifndef SIMCOM_7600E_MEMORY_H_
+#define SIMCOM_7600E_MEMORY_H_
+
+#include "conf.h"
+#include <at-command.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SIM_MEM_ALIGN(sz)   (((sz) + sizeof(void*) - 1) & ~(sizeof(void*) - 1))
+#define SIM_MEM_DATA(n)     SIM_MEM_ALIGN(sizeof(AT_Data_t)*(n))
+
+// hex "lac"/"ci" strings of a registration report, 28 bit cell ids on LTE
+#define SIM_CELL_STR_SIZE   12
+#define SIM_MEM_REG_RESP    (SIM_MEM_DATA(4) + SIM_MEM_ALIGN(2*SIM_CELL_STR_SIZE))
+
+// storage of the URC handlers registered by each feature
+#define SIM_MEM_CORE_SIZE \
+  ((SIM_EN_URC_SIMCARD? 2*(SIM_MEM_DATA(1) + SIM_MEM_ALIGN(16)): 0) +\
+   (SIM_EN_URC_REGISTRATION? SIM_MEM_REG_RESP: 0) +\
+   (SIM_EN_URC_SIGNAL? SIM_MEM_DATA(2) + SIM_MEM_DATA(14) + SIM_MEM_ALIGN(8*4 + 16): 0))
+#define SIM_MEM_NET_SIZE \
+  (((SIM_EN_FEATURE_NET) && SIM_EN_URC_REGISTRATION)? 2*SIM_MEM_REG_RESP: 0)
+#define SIM_MEM_SOCKET_SIZE \
+  (SIM_EN_FEATURE_SOCKET? SIM_MEM_DATA(1) + 2*SIM_MEM_DATA(2): 0)
+#define SIM_MEM_HTTP_SIZE \
+  (SIM_EN_FEATURE_HTTP? SIM_MEM_DATA(3) + 2*(SIM_MEM_DATA(2) + SIM_MEM_ALIGN(8)): 0)
+
+#define SIM_MEM_POWER_SIZE \
+  (SIM_EN_FEATURE_POWER? SIM_MEM_DATA(1) + SIM_MEM_ALIGN(16): 0)
+
+#define SIM_MEM_POOL_SIZE \
+  (SIM_MEM_CORE_SIZE + SIM_MEM_NET_SIZE + SIM_MEM_SOCKET_SIZE + SIM_MEM_HTTP_SIZE +\
+   SIM_MEM_POWER_SIZE)
+
+typedef struct {
+  const char  *name;
+  uint32_t    size;       // bytes of RAM, inside the handler or from the heap
+} SIM_Footprint_t;
+
+void*   SIM_Malloc(void *hsim, size_t size);
+uint8_t SIM_MEM_GetFootprint(const SIM_Footprint_t **table);
+
+#endif /* SIMCOM_7600E_MEMORY_H_ */
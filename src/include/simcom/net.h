@@ -27,6 +27,25 @@ enum {
   SIM_NET_STATE_ONLINE,
 };
 
+enum {
+  SIM_NET_PDP_IP,
+  SIM_NET_PDP_IPV6,
+  SIM_NET_PDP_IPV4V6,
+};
+
+typedef struct {
+  uint8_t cid;        // 0 while the slot is free
+  uint8_t type;       // SIM_NET_PDP_IP, SIM_NET_PDP_IPV6 or SIM_NET_PDP_IPV4V6
+  uint8_t isActive;
+  char    *APN;
+  char    *user;
+  char    *pass;
+
+  // assigned by the network, "" when the context has none of that family
+  char    ipv4[16];
+  char    ipv6[40];
+} SIM_NET_PDP_t;
+
 typedef struct {
   void *hsim;         // SIM_HandlerTypeDef
   uint8_t status;
@@ -34,11 +53,9 @@ typedef struct {
   uint8_t events;
   uint32_t stateTick;
 
-  struct {
-    char *APN;
-    char *user;
-    char *pass;
-  } APN;
+  SIM_NET_PDP_t pdp[SIM_NET_PDP_NUM];
+  uint32_t      activateTick;
+  uint8_t       boundCid;   // +CSOCKSETPN of the socket stack and http, 0 if unknown
 
   void (*onOpening)(void);
   void (*onOpened)(void);
@@ -46,11 +63,19 @@ typedef struct {
   void (*onClosed)(void);
 
   uint8_t gprs_status;
+  uint8_t eps_status;
 } SIM_NET_HandlerTypeDef;
 
 
 SIM_Status_t SIM_NET_Init(SIM_NET_HandlerTypeDef*, void *hsim);
 void         SIM_NET_SetupAPN(SIM_NET_HandlerTypeDef*, char *APN, char *user, char *pass);
+SIM_Status_t SIM_NET_SetupPDP(SIM_NET_HandlerTypeDef*, uint8_t cid,
+                              char *APN, char *user, char *pass);
+SIM_Status_t SIM_NET_SetPDPType(SIM_NET_HandlerTypeDef*, uint8_t cid, uint8_t type);
+uint8_t      SIM_NET_IsPDPActive(SIM_NET_HandlerTypeDef*, uint8_t cid);
+const SIM_NET_PDP_t* SIM_NET_GetPDP(SIM_NET_HandlerTypeDef*, uint8_t cid);
+SIM_Status_t SIM_NET_ReadAddress(SIM_NET_HandlerTypeDef*, uint8_t cid);
+SIM_Status_t SIM_NET_BindContext(SIM_NET_HandlerTypeDef*, uint8_t cid);
 
 void         SIM_NET_SetState(SIM_NET_HandlerTypeDef*, uint8_t newState);
 void         SIM_NET_OnNewState(SIM_NET_HandlerTypeDef*);
@@ -26,7 +26,7 @@ typedef struct {
 
   struct {
     uint32_t retryInterval;
-    uint32_t resyncInterval;
+    uint32_t resyncInterval;  // ms, the upper bound of the clock adaptive one
   } config;
 } SIM_NTP_HandlerTypeDef;
 
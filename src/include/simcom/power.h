@@ -0,0 +1,90 @@
+/*
+ * power.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ */
+
+#ifndef SIMCOM_7600E_POWER_H_
+#define SIMCOM_7600E_POWER_H_
+
+#include "conf.h"
+#if SIM_EN_FEATURE_POWER
+
+#include "types.h"
+
+enum {
+  SIM_PWR_STATE_ACTIVE,
+  SIM_PWR_STATE_SLEEP,          // DTR high, modem sleeps while the UART is idle
+  SIM_PWR_STATE_PSM,            // modem reported entering PSM
+  SIM_PWR_NUM_OF_STATE,
+};
+
+enum {
+  SIM_PWR_SLEEP_NONE,
+  SIM_PWR_SLEEP_DTR,            // +CSCLK=1, DTR controls the UART sleep
+};
+
+// <AcT-type> of +CEDRXS
+enum {
+  SIM_PWR_EDRX_DISABLE  = 0,
+  SIM_PWR_EDRX_GSM      = 2,
+  SIM_PWR_EDRX_LTE      = 4,
+  SIM_PWR_EDRX_LTE_M    = 4,
+  SIM_PWR_EDRX_NB_IOT   = 5,
+};
+
+typedef struct {
+  uint8_t   sleepMode;
+  uint32_t  idleTime;           // ms without AT traffic or events before sleeping
+
+  uint8_t   psmEnable;
+  uint32_t  psmTau;             // s, requested periodic TAU (T3412 extended)
+  uint32_t  psmActiveTime;      // s, requested active time (T3324)
+
+  uint8_t   edrxAct;            // SIM_PWR_EDRX_*
+  uint8_t   edrxCycle;          // 4 bit eDRX value of 3GPP TS 24.008
+} SIM_PWR_Config_t;
+
+typedef struct {
+  uint32_t  time[SIM_PWR_NUM_OF_STATE];  // ms spent in each state
+  uint32_t  wakeups;
+} SIM_PWR_Report_t;
+
+typedef struct {
+  void              *hsim;
+  volatile uint8_t  state;
+  volatile uint8_t  events;
+  volatile uint8_t  busy;       // library AT commands in flight
+  uint8_t           isApplied;
+  uint8_t           isConfigured;
+  SIM_PWR_Config_t  config;
+
+  volatile uint32_t activityTick;
+  uint32_t          stateTick;
+  SIM_PWR_Report_t  report;
+  volatile uint32_t reportSeq;
+
+  // level of the DTR line, required for SIM_PWR_SLEEP_DTR
+  void (*setDTR)(uint8_t level);
+  // pulses PWRKEY or PSM_EINT to leave PSM, optional
+  void (*wakeup)(void);
+} SIM_PWR_HandlerTypeDef;
+
+SIM_Status_t SIM_PWR_Init(SIM_PWR_HandlerTypeDef*, void *hsim);
+void         SIM_PWR_Setup(SIM_PWR_HandlerTypeDef*, const SIM_PWR_Config_t*);
+SIM_Status_t SIM_PWR_Apply(SIM_PWR_HandlerTypeDef*);
+void         SIM_PWR_OnEvent(SIM_PWR_HandlerTypeDef*);
+void         SIM_PWR_Loop(SIM_PWR_HandlerTypeDef*);
+uint8_t      SIM_PWR_IsSleeping(SIM_PWR_HandlerTypeDef*);
+
+void         SIM_PWR_Wake(SIM_PWR_HandlerTypeDef*);
+void         SIM_PWR_OnRing(SIM_PWR_HandlerTypeDef*);
+void         SIM_PWR_BeginCommand(SIM_PWR_HandlerTypeDef*);
+void         SIM_PWR_EndCommand(SIM_PWR_HandlerTypeDef*);
+
+void         SIM_PWR_GetReport(SIM_PWR_HandlerTypeDef*, SIM_PWR_Report_t*);
+void         SIM_PWR_ResetReport(SIM_PWR_HandlerTypeDef*);
+
+#endif /* SIM_EN_FEATURE_POWER */
+#endif /* SIMCOM_7600E_POWER_H_ */
@@ -12,6 +12,8 @@
 #if SIM_EN_FEATURE_SOCKET
 
 #include "types.h"
+#include "atqueue.h"
+#include "usage.h"
 
 #define SIM_SOCK_UDP    0
 #define SIM_SOCK_TCPIP  1
@@ -21,6 +23,19 @@
 #define SIM_SOCK_EVENT_ON_RECEIVED      0x04
 #define SIM_SOCK_EVENT_ON_CLOSED        0x08
 
+// typed events posted by the URC handlers to the socket manager queue
+enum {
+  SIM_SOCK_EVT_OPENED,
+  SIM_SOCK_EVT_OPEN_ERROR,
+  SIM_SOCK_EVT_CLOSED,
+};
+
+typedef struct {
+  uint8_t   kind;
+  int8_t    linkNum;
+  uint8_t   status;           // error code reported by the modem
+} SIM_SockEvent_t;
+
 enum {
   SIM_SOCK_CLIENT_STATE_CLOSE,
   SIM_SOCK_CLIENT_STATE_WAIT_NETOPEN,
@@ -42,6 +57,7 @@ typedef struct {
     uint32_t timeout;
     uint8_t  autoReconnect;
     uint16_t reconnectingDelay;
+    uint8_t  cid;                   // PDP context, 0 for SIM_NET_DEFAULT_CID
   } config;
 
   // tick register for delay and timeout
@@ -56,13 +72,17 @@ typedef struct {
 
   void *buffer;
 
+#if SIM_EN_FEATURE_USAGE
+  SIM_Usage_Counter_t usage;
+#endif
+
   // listener
   struct {
     void (*onConnecting)(void);
     void (*onConnected)(void);
     void (*onConnectError)(void);
     void (*onClosed)(void);
-    void (*onReceived)(void *buffer);
+    void (*onReceived)(void *buffer, uint16_t length);  // AT handler thread
   } listeners;
 } SIM_SocketClient_t;
 
@@ -70,12 +90,21 @@ typedef struct {
 // SOCKET
 SIM_Status_t  SIM_SockClient_Init(SIM_SocketClient_t*, const char *host, uint16_t port, void *buffer);
 SIM_Status_t  SIM_SockClient_CheckEvents(SIM_SocketClient_t*);
+void          SIM_SockClient_OnEvent(SIM_SocketClient_t*, const SIM_SockEvent_t*);
 SIM_Status_t  SIM_SockClient_OnNetOpened(SIM_SocketClient_t*);
+uint8_t       SIM_SockClient_OnModemReset(SIM_SocketClient_t*);
 SIM_Status_t  SIM_SockClient_Loop(SIM_SocketClient_t*);
 void          SIM_SockClient_SetBuffer(SIM_SocketClient_t*, void *buffer);
 SIM_Status_t  SIM_SockClient_Open(SIM_SocketClient_t*, void*);
 SIM_Status_t  SIM_SockClient_Close(SIM_SocketClient_t*);
 uint16_t      SIM_SockClient_SendData(SIM_SocketClient_t*, uint8_t *data, uint16_t length);
+#if SIM_EN_FEATURE_ATQUEUE
+SIM_Status_t  SIM_SockClient_SendDataAsync(SIM_SocketClient_t*, SIM_ATQ_Cmd_t*,
+                                           const uint8_t *data, uint16_t length);
+#endif
+#if SIM_EN_FEATURE_USAGE
+void          SIM_SockClient_GetUsage(SIM_SocketClient_t*, SIM_Usage_Counter_t*);
+#endif
 
 
 #endif /* SIM_EN_FEATURE_SOCKET */
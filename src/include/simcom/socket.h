@@ -28,8 +28,24 @@ typedef struct SIM_Socket_HandlerTypeDef {
   void                *hsim;
   uint8_t             state;
   uint32_t            stateTick;
+  uint8_t             cid;          // context the stack is opened on
   uint8_t             socketsNb;
   SIM_SocketClient_t  *sockets[SIM_NUM_OF_SOCKET];
+
+  // AT handler thread only, the +RECEIVE whose payload is being read
+  struct {
+    int8_t            linkNum;      // -1 if none
+    uint16_t          length;
+  } rxPending;
+
+  // MPSC ring, posted from the AT handler thread, drained by the SIM thread
+  struct {
+    SIM_SockEvent_t   events[SIM_SOCK_EVENT_QUEUE_SIZE];
+    volatile uint8_t  ready[SIM_SOCK_EVENT_QUEUE_SIZE];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t overflows;    // events which went to the sockets' bit flags
+  } evtQueue;
 } SIM_Socket_HandlerTypeDef;
 
 SIM_Status_t SIM_SockManager_Init(SIM_Socket_HandlerTypeDef*, void *hsim);
@@ -37,9 +53,11 @@ void         SIM_SockManager_SetState(SIM_Socket_HandlerTypeDef*, uint8_t newSta
 SIM_Status_t SIM_SockManager_OnNewState(SIM_Socket_HandlerTypeDef*);
 void         SIM_SockManager_CheckSocketsEvents(SIM_Socket_HandlerTypeDef*);
 void         SIM_SockManager_Loop(SIM_Socket_HandlerTypeDef*);
+void         SIM_SockManager_OnATProcessed(SIM_Socket_HandlerTypeDef*);
 
 SIM_Status_t SIM_SockManager_CheckNetOpen(SIM_Socket_HandlerTypeDef*);
 SIM_Status_t SIM_SockManager_NetOpen(SIM_Socket_HandlerTypeDef*);
+uint32_t     SIM_SockManager_OnModemReset(SIM_Socket_HandlerTypeDef*);
 
 
 #endif /* SIM_EN_FEATURE_SOCKET */
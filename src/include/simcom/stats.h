@@ -0,0 +1,45 @@
+/*
+ * stats.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ */
+
+#ifndef SIMCOM_7600E_STATS_H_
+#define SIMCOM_7600E_STATS_H_
+
+#include "conf.h"
+#if SIM_EN_FEATURE_STATS
+
+#include "types.h"
+#include <at-command.h>
+
+#define SIM_STATS_CMD_NAME_LEN    16
+#define SIM_STATS_NUM_OF_BUCKETS  8   // <=10, <=50, <=100, <=250, <=500, <=1000, <=5000, >5000 ms
+
+typedef struct {
+  char      name[SIM_STATS_CMD_NAME_LEN]; // "+CSQ", "+CREG?" for checks, "<batch>" for joined lines
+  uint32_t  calls;
+  uint32_t  errors;
+  uint32_t  timeouts;
+  uint32_t  totalTime;                    // ms
+  uint32_t  maxTime;                      // ms
+  uint32_t  histogram[SIM_STATS_NUM_OF_BUCKETS];
+} SIM_Stats_Cmd_t;
+
+typedef struct {
+  void              *hsim;
+  uint32_t          dropped;              // calls of commands which didn't fit in the table
+  volatile uint8_t  slotState[SIM_STATS_NUM_OF_CMD];
+  SIM_Stats_Cmd_t   cmds[SIM_STATS_NUM_OF_CMD];
+} SIM_Stats_HandlerTypeDef;
+
+SIM_Status_t SIM_Stats_Init(SIM_Stats_HandlerTypeDef*, void *hsim);
+void         SIM_Stats_Record(SIM_Stats_HandlerTypeDef*, const char *cmd, uint8_t isCheck,
+                              uint32_t elapsed, AT_Status_t result);
+uint8_t      SIM_Stats_Count(SIM_Stats_HandlerTypeDef*);
+SIM_Status_t SIM_Stats_Get(SIM_Stats_HandlerTypeDef*, uint8_t idx, SIM_Stats_Cmd_t*);
+void         SIM_Stats_Reset(SIM_Stats_HandlerTypeDef*);
+
+#endif /* SIM_EN_FEATURE_STATS */
+#endif /* SIMCOM_7600E_STATS_H_ */
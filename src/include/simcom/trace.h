@@ -0,0 +1,79 @@
+/*
+ * trace.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ */
+
+#ifndef SIMCOM_7600E_TRACE_H_
+#define SIMCOM_7600E_TRACE_H_
+
+#include "conf.h"
+#include "types.h"
+
+// low nibble of SIM_TraceRecord_t.module, the high nibble holds the socket link
+enum {
+  SIM_TRACE_MOD_CORE,
+  SIM_TRACE_MOD_NET,
+  SIM_TRACE_MOD_SOCKMGR,
+  SIM_TRACE_MOD_SOCKET,
+  SIM_TRACE_MOD_GPS,
+  SIM_TRACE_MOD_HTTP,
+  SIM_TRACE_MOD_POWER,
+  SIM_TRACE_MOD_WATCHDOG,
+};
+
+enum {
+  SIM_TRACE_CAUSE_NONE,
+  SIM_TRACE_CAUSE_OK,         // previous step succeeded
+  SIM_TRACE_CAUSE_ERROR,      // command failed or modem reported an error
+  SIM_TRACE_CAUSE_TIMEOUT,    // state timed out and is retried or dropped
+  SIM_TRACE_CAUSE_URC,        // unsolicited report of the modem
+  SIM_TRACE_CAUSE_USER,       // api call of the application
+  SIM_TRACE_CAUSE_RESET,      // modem restarted ("RDY")
+};
+
+#if SIM_EN_FEATURE_TRACE
+
+#define SIM_TRACE_MAGIC     0x544D4953UL  // "SIMT"
+#define SIM_TRACE_VERSION   1
+
+typedef struct {
+  uint32_t  tick;
+  uint8_t   module;
+  uint8_t   oldState;
+  uint8_t   newState;
+  uint8_t   cause;
+} SIM_TraceRecord_t;
+
+// layout of SIM_Trace_Dump output, followed by count records oldest first
+typedef struct {
+  uint32_t  magic;
+  uint8_t   version;
+  uint8_t   recordSize;
+  uint16_t  count;
+  uint32_t  lost;             // records overwritten since the last reset
+} SIM_TraceHeader_t;
+
+typedef struct {
+  volatile uint32_t   head;   // records written so far
+  SIM_TraceRecord_t   records[SIM_TRACE_SIZE];
+} SIM_Trace_HandlerTypeDef;
+
+void      SIM_Trace_Init(SIM_Trace_HandlerTypeDef*);
+void      SIM_Trace_Record(void *hsim, uint8_t module, uint8_t oldState, uint8_t newState,
+                           uint8_t cause);
+uint16_t  SIM_Trace_Read(SIM_Trace_HandlerTypeDef*, SIM_TraceRecord_t *dst, uint16_t max);
+uint32_t  SIM_Trace_Dump(SIM_Trace_HandlerTypeDef*,
+                         void (*write)(void *context, const void *data, uint16_t len),
+                         void *context);
+
+#define SIM_TRACE(hsim, module, oldState, newState, cause) \
+  SIM_Trace_Record((hsim), (module), (oldState), (newState), (cause))
+
+#else
+// cause is often a parameter passed only for the trace
+#define SIM_TRACE(hsim, module, oldState, newState, cause) ((void) (cause))
+#endif /* SIM_EN_FEATURE_TRACE */
+
+#endif /* SIMCOM_7600E_TRACE_H_ */
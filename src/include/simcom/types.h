@@ -19,4 +19,94 @@ typedef struct {
   int8_t  timezone;
 } SIM_Datetime_t;
 
+// time of each bring-up phase in ms since SIM_Init or the last "RDY",
+// 0 while the phase was not reached yet
+typedef struct {
+  uint32_t atReady;
+  uint32_t simReady;
+  uint32_t registered;
+  uint32_t online;
+} SIM_BootTiming_t;
+
+typedef enum {
+  SIM_CARD_UNKNOWN,
+  SIM_CARD_READY,
+  SIM_CARD_PIN,           // waiting for the PIN
+  SIM_CARD_PUK,           // PIN blocked
+  SIM_CARD_PIN2,
+  SIM_CARD_PUK2,
+  SIM_CARD_PH_PIN,        // phone or network personalisation lock
+  SIM_CARD_NOT_READY,     // still initialising
+  SIM_CARD_NOT_INSERTED,
+} SIM_CardStatus_t;
+
+typedef enum {
+  SIM_RAT_UNKNOWN,
+  SIM_RAT_GSM,
+  SIM_RAT_WCDMA,
+  SIM_RAT_LTE,
+} SIM_RAT_t;
+
+typedef struct {
+  uint32_t  tick;       // getTick() of the last update
+  uint8_t   rat;        // SIM_RAT_t
+  uint8_t   rssi;       // +CSQ scale, 0-31 or 99 if unknown
+  uint8_t   ber;        // +CSQ scale, 0-7 or 99 if unknown
+  int16_t   rsrp;       // LTE only, 0.1 dBm
+  int16_t   rsrq;       // LTE only, 0.1 dB
+  int16_t   sinr;       // LTE only, dB
+} SIM_RadioMetrics_t;
+
+typedef struct {
+  uint32_t  tick;       // getTick() of the last update
+  uint32_t  ci;         // cell identity, 28 bits on LTE
+  uint16_t  lac;        // location area code, tracking area code on LTE
+  uint16_t  pcid;       // LTE only, physical cell id
+  uint16_t  band;       // LTE only, E-UTRA band number or 0
+  uint8_t   rat;        // SIM_RAT_t
+  char      plmn[7];    // MCC and MNC digits, "" until +CPSI is seen
+} SIM_CellInfo_t;
+
+// operator the modem was last registered on, persisted by the application
+typedef struct {
+  char      plmn[7];    // MCC and MNC digits, "" if unknown
+  uint8_t   rat;        // SIM_RAT_t
+} SIM_Operator_t;
+
+// network scan modes of +CNMP
+enum {
+  SIM_SCAN_AUTO           = 2,
+  SIM_SCAN_GSM            = 13,
+  SIM_SCAN_WCDMA          = 14,
+  SIM_SCAN_GSM_WCDMA      = 19,
+  SIM_SCAN_LTE            = 38,
+  SIM_SCAN_GSM_WCDMA_LTE  = 39,
+  SIM_SCAN_GSM_LTE        = 51,
+  SIM_SCAN_WCDMA_LTE      = 54,
+};
+
+#define SIM_RADIO_KEEP  0xFF  // mode or order left as the modem has it
+
+// written to the modem only where it differs, the modem keeps them in NVM
+typedef struct {
+  uint8_t   mode;       // SIM_SCAN_*
+  uint8_t   order;      // +CNAOP acquisition order, 0 automatic
+  uint64_t  bands;      // +CNBP GSM/WCDMA band mask, 0 leaves it
+  uint64_t  lteBands;   // +CNBP LTE band mask, bit n-1 for band n, 0 leaves it
+} SIM_RadioPref_t;
+
+enum {
+  SIM_REG_STRATEGY_AUTO,          // full PLMN search, +COPS=0
+  SIM_REG_STRATEGY_LAST_OPERATOR, // +COPS=4 on the saved operator
+  SIM_REG_STRATEGY_NB,
+};
+
+typedef struct {
+  uint32_t  attempts;
+  uint32_t  registered;
+  uint32_t  misses;     // registered on another PLMN than the one selected
+  uint32_t  lastTime;   // ms from the selection to registered
+  uint32_t  totalTime;
+} SIM_RegStats_t;
+
 #endif /* SIMCOM_7600E_TYPES_H*/
@@ -0,0 +1,59 @@
+/*
+ * usage.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ */
+
+#ifndef SIMCOM_7600E_USAGE_H_
+#define SIMCOM_7600E_USAGE_H_
+
+#include "conf.h"
+#if SIM_EN_FEATURE_USAGE
+
+#include "types.h"
+
+#if !(SIM_EN_FEATURE_NET)
+#error "SIM_EN_FEATURE_USAGE needs SIM_EN_FEATURE_SOCKET, SIM_EN_FEATURE_HTTP or SIM_EN_FEATURE_NTP"
+#endif
+
+enum {
+  SIM_USAGE_SOCKET,
+  SIM_USAGE_HTTP,
+};
+
+// payload bytes, 32 bits so any thread can add without a lock
+typedef struct {
+  uint32_t txBytes;
+  uint32_t rxBytes;
+} SIM_Usage_Counter_t;
+
+typedef struct {
+  uint8_t             cid;        // 0 while the slot is free
+  SIM_Usage_Counter_t socket;     // counted by the library
+  SIM_Usage_Counter_t http;
+  SIM_Usage_Counter_t modem;      // counted by the modem, IP overhead included
+  uint32_t            modemTick;  // getTick() of the last modem read, 0 if never
+} SIM_Usage_Context_t;
+
+typedef struct {
+  void                *hsim;
+  volatile uint32_t   seq;        // guards the modem counters
+  uint32_t            lastRead;
+  SIM_Usage_Counter_t modemRaw[SIM_NET_PDP_NUM];
+  SIM_Usage_Context_t contexts[SIM_NET_PDP_NUM];
+} SIM_Usage_HandlerTypeDef;
+
+SIM_Status_t SIM_Usage_Init(SIM_Usage_HandlerTypeDef*, void *hsim);
+void         SIM_Usage_Count(SIM_Usage_Counter_t*, uint32_t tx, uint32_t rx);
+void         SIM_Usage_Add(SIM_Usage_HandlerTypeDef*, uint8_t cid, uint8_t source,
+                           uint32_t tx, uint32_t rx);
+void         SIM_Usage_Loop(SIM_Usage_HandlerTypeDef*);
+SIM_Status_t SIM_Usage_ReadModem(SIM_Usage_HandlerTypeDef*, uint8_t cid);
+
+void         SIM_Usage_Snapshot(const SIM_Usage_Counter_t*, SIM_Usage_Counter_t*);
+SIM_Status_t SIM_Usage_GetContext(SIM_Usage_HandlerTypeDef*, uint8_t cid, SIM_Usage_Context_t*);
+void         SIM_Usage_Reset(SIM_Usage_HandlerTypeDef*);
+
+#endif /* SIM_EN_FEATURE_USAGE */
+#endif /* SIMCOM_7600E_USAGE_H_ */
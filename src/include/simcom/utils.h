@@ -21,10 +21,32 @@
 #define SIM_BITS_SET(bits, bit)    {(bits) |= (bit);}
 #define SIM_BITS_UNSET(bits, bit)  {(bits) &= ~(bit);}
 
+// sequence counter guarding data that is read lock-free from other threads
+#define SIM_SEQ_WRITE_BEGIN(seq)  {(seq)++; __sync_synchronize();}
+#define SIM_SEQ_WRITE_END(seq)    {__sync_synchronize(); (seq)++;}
+
 #define SIM_IS_STATUS(hsim, stat)     SIM_BITS_IS_ALL((hsim)->status, stat)
 #define SIM_SET_STATUS(hsim, stat)    SIM_BITS_SET((hsim)->status, stat)
 #define SIM_UNSET_STATUS(hsim, stat)  SIM_BITS_UNSET((hsim)->status, stat)
 
+#if SIM_EN_AT_HOOK
+// every AT call of the library is routed through the hooks in core.c
+#define AT_Command(hat, ...)      SIM_AT_Command(hat, __VA_ARGS__)
+#define AT_Check(hat, ...)        SIM_AT_Check(hat, __VA_ARGS__)
+#define AT_CommandWrite(hat, ...) SIM_AT_CommandWrite(hat, __VA_ARGS__)
+
+AT_Status_t SIM_AT_Command(AT_HandlerTypeDef*, const char *cmd,
+                           uint8_t paramNb, AT_Data_t *params,
+                           uint8_t respNb, AT_Data_t *resp);
+AT_Status_t SIM_AT_Check(AT_HandlerTypeDef*, const char *cmd,
+                         uint8_t respNb, AT_Data_t *resp);
+AT_Status_t SIM_AT_CommandWrite(AT_HandlerTypeDef*, const char *cmd, const char *prompt,
+                                const uint8_t *data, uint16_t length,
+                                uint8_t paramNb, AT_Data_t *params,
+                                uint8_t respNb, AT_Data_t *resp);
+AT_Status_t SIM_AT_CommandTimeout(AT_HandlerTypeDef*, const char *cmd, uint32_t timeout);
+#endif /* SIM_EN_AT_HOOK */
+
 #if SIM_EN_FEATURE_MQTT
 #define SIM_MQTT_IS_STATUS(hsim, stat)     SIM_BITS_IS_ALL((hsim)->mqtt.status, stat)
 #define SIM_MQTT_SET_STATUS(hsim, stat)    SIM_BITS_SET((hsim)->mqtt.status, stat)
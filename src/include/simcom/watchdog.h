@@ -0,0 +1,59 @@
+/*
+ * watchdog.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ */
+
+#ifndef SIMCOM_7600E_WATCHDOG_H_
+#define SIMCOM_7600E_WATCHDOG_H_
+
+#include "conf.h"
+#if SIM_EN_FEATURE_WATCHDOG
+
+#include "types.h"
+#include <at-command.h>
+
+enum {
+  SIM_WDG_STAGE_IDLE,
+  SIM_WDG_STAGE_DETECTED,       // too many consecutive timeouts
+  SIM_WDG_STAGE_SOFT_RESET,     // +CFUN=1,1 sent, waiting for "RDY"
+  SIM_WDG_STAGE_HARD_RESET,     // hardReset hook called, waiting for "RDY"
+  SIM_WDG_STAGE_RESTORING,      // modem answers, waiting for the network and sockets
+};
+
+typedef struct {
+  uint32_t  detections;         // stuck channels and unexpected restarts
+  uint32_t  softResets;
+  uint32_t  hardResets;
+  uint32_t  recoveries;
+  uint32_t  lastRecoverTime;    // ms from the detection to the sessions restored
+  uint32_t  maxRecoverTime;
+} SIM_WDG_Stats_t;
+
+typedef struct {
+  void              *hsim;
+  volatile uint8_t  stage;
+  volatile uint8_t  timeouts;   // consecutive AT timeouts
+  volatile uint8_t  flags;
+  uint8_t           isRestored;
+  uint32_t          restoreMask;  // links to reopen
+  uint32_t          detectTick;
+  uint32_t          stageTick;
+  SIM_WDG_Stats_t   stats;
+
+  // resets the modem through its RESET pin or power, optional
+  void (*hardReset)(void);
+  void (*onRecovered)(uint32_t recoverTime);
+} SIM_WDG_HandlerTypeDef;
+
+SIM_Status_t SIM_WDG_Init(SIM_WDG_HandlerTypeDef*, void *hsim);
+void         SIM_WDG_OnResult(SIM_WDG_HandlerTypeDef*, AT_Status_t result);
+void         SIM_WDG_OnReady(SIM_WDG_HandlerTypeDef*);
+void         SIM_WDG_OnEvent(SIM_WDG_HandlerTypeDef*);
+void         SIM_WDG_Loop(SIM_WDG_HandlerTypeDef*);
+uint8_t      SIM_WDG_IsResetting(SIM_WDG_HandlerTypeDef*);
+void         SIM_WDG_GetStats(SIM_WDG_HandlerTypeDef*, SIM_WDG_Stats_t*);
+
+#endif /* SIM_EN_FEATURE_WATCHDOG */
+#endif /* SIMCOM_7600E_WATCHDOG_H_ */
@@ -0,0 +1,172 @@
+/*
+ * atqueue.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ */
+
+#include "../include/simcom/atqueue.h"
+#if SIM_EN_FEATURE_ATQUEUE
+
+#include "../include/simcom.h"
+#include "../include/simcom/utils.h"
+#include "../events.h"
+
+static void collectSubmitted(SIM_ATQ_HandlerTypeDef*);
+static SIM_ATQ_Cmd_t* popNext(SIM_ATQ_HandlerTypeDef*);
+
+
+SIM_Status_t SIM_ATQ_Init(SIM_ATQ_HandlerTypeDef *hsimAtq, void *hsim)
+{
+  if (((SIM_HandlerTypeDef*)hsim)->key != SIM_KEY)
+    return SIM_ERROR;
+
+  hsimAtq->hsim = hsim;
+  hsimAtq->submitted = 0;
+  hsimAtq->dataTick = 0;
+  for (uint8_t i = 0; i < SIM_ATQ_NUM_OF_PRIO; i++) {
+    hsimAtq->head[i] = 0;
+    hsimAtq->tail[i] = 0;
+  }
+
+  return SIM_OK;
+}
+
+
+// non-blocking, can be called from any thread
+SIM_Status_t SIM_ATQ_Submit(SIM_ATQ_HandlerTypeDef *hsimAtq, SIM_ATQ_Cmd_t *cmd)
+{
+  return SIM_ATQ_SubmitHooked(hsimAtq, cmd, 0, 0);
+}
+
+
+// for the modules, onDone sees the result before the caller's onComplete
+SIM_Status_t SIM_ATQ_SubmitHooked(SIM_ATQ_HandlerTypeDef *hsimAtq, SIM_ATQ_Cmd_t *cmd,
+                                  void (*onDone)(SIM_ATQ_Cmd_t*), void *owner)
+{
+  SIM_ATQ_Cmd_t *top;
+
+  if (cmd->priority >= SIM_ATQ_NUM_OF_PRIO) return SIM_ERROR;
+  if (cmd->paramNb > SIM_ATQ_MAX_PARAMS) return SIM_ERROR;
+
+  cmd->status = SIM_TIMEOUT;
+  cmd->onDone = onDone;
+  cmd->owner  = owner;
+  if (cmd->priority == SIM_ATQ_PRIO_DATA)
+    SIM_ATQ_MarkData(hsimAtq);
+
+  top = __atomic_load_n(&hsimAtq->submitted, __ATOMIC_RELAXED);
+  do {
+    cmd->next = top;
+  } while (!__atomic_compare_exchange_n(&hsimAtq->submitted, &top, cmd,
+                                        1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+  SIM_EventSet(hsimAtq->hsim, SIM_RTOS_EVT_ATQ_NEW_CMD);
+  return SIM_OK;
+}
+
+
+// runs queued commands on the SIM thread, highest priority first
+void SIM_ATQ_Process(SIM_ATQ_HandlerTypeDef *hsimAtq)
+{
+  SIM_HandlerTypeDef *hsim = hsimAtq->hsim;
+  SIM_ATQ_Cmd_t *cmd;
+  AT_Status_t result;
+
+  for (;;) {
+    // pick up new submissions between commands so data can overtake
+    collectSubmitted(hsimAtq);
+
+    cmd = popNext(hsimAtq);
+    if (cmd == 0) break;
+
+    if (cmd->data != 0) {
+      result = AT_CommandWrite(&hsim->atCmd, cmd->cmd, ">", cmd->data, cmd->dataLen,
+                               cmd->paramNb, cmd->params, cmd->respNb, cmd->resp);
+    } else {
+      result = AT_Command(&hsim->atCmd, cmd->cmd, cmd->paramNb, cmd->params,
+                          cmd->respNb, cmd->resp);
+    }
+
+    if (result == AT_OK)            cmd->status = SIM_OK;
+    else if (result == AT_TIMEOUT)  cmd->status = SIM_TIMEOUT;
+    else                            cmd->status = SIM_ERROR;
+
+    if (cmd->onDone) cmd->onDone(cmd);
+    if (cmd->onComplete) cmd->onComplete(cmd);
+  }
+}
+
+
+void SIM_ATQ_MarkData(SIM_ATQ_HandlerTypeDef *hsimAtq)
+{
+  SIM_HandlerTypeDef *hsim = hsimAtq->hsim;
+  uint32_t tick = hsim->getTick();
+
+  __atomic_store_n(&hsimAtq->dataTick, (tick == 0)? 1: tick, __ATOMIC_RELAXED);
+}
+
+
+// SIM thread only, registers the deadline when the data path goes idle
+uint8_t SIM_ATQ_IsDataFlowing(SIM_ATQ_HandlerTypeDef *hsimAtq)
+{
+  SIM_HandlerTypeDef *hsim = hsimAtq->hsim;
+  uint32_t dataTick = __atomic_load_n(&hsimAtq->dataTick, __ATOMIC_RELAXED);
+
+  if (dataTick == 0) return 0;
+  // fails when SIM_ATQ_MarkData ran in between, the data is flowing again
+  if (SIM_CheckTimeout(hsim, dataTick, SIM_ATQ_DATA_IDLE_TIME)
+      && __atomic_compare_exchange_n(&hsimAtq->dataTick, &dataTick, 0,
+                                     0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    return 0;
+  return 1;
+}
+
+
+static void collectSubmitted(SIM_ATQ_HandlerTypeDef *hsimAtq)
+{
+  SIM_ATQ_Cmd_t *cmd = __atomic_exchange_n(&hsimAtq->submitted, 0, __ATOMIC_ACQUIRE);
+  SIM_ATQ_Cmd_t *fifo = 0;
+  SIM_ATQ_Cmd_t *next;
+
+  // the stack is newest first, reverse it to keep the submission order
+  while (cmd != 0) {
+    next = cmd->next;
+    cmd->next = fifo;
+    fifo = cmd;
+    cmd = next;
+  }
+
+  while (fifo != 0) {
+    next = fifo->next;
+    fifo->next = 0;
+    if (hsimAtq->tail[fifo->priority] == 0)
+      hsimAtq->head[fifo->priority] = fifo;
+    else
+      hsimAtq->tail[fifo->priority]->next = fifo;
+    hsimAtq->tail[fifo->priority] = fifo;
+    fifo = next;
+  }
+}
+
+
+static SIM_ATQ_Cmd_t* popNext(SIM_ATQ_HandlerTypeDef *hsimAtq)
+{
+  SIM_ATQ_Cmd_t *cmd;
+
+  for (uint8_t prio = 0; prio < SIM_ATQ_NUM_OF_PRIO; prio++) {
+    if (hsimAtq->head[prio] == 0) continue;
+    if (prio == SIM_ATQ_PRIO_HOUSEKEEPING && SIM_ATQ_IsDataFlowing(hsimAtq)) break;
+
+    cmd = hsimAtq->head[prio];
+    hsimAtq->head[prio] = cmd->next;
+    if (hsimAtq->head[prio] == 0)
+      hsimAtq->tail[prio] = 0;
+    cmd->next = 0;
+    return cmd;
+  }
+
+  return 0;
+}
+
+#endif /* SIM_EN_FEATURE_ATQUEUE */
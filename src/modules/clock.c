@@ -0,0 +1,313 @@
+/*
+ * clock.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ */
+
+#include "../include/simcom/clock.h"
+#if SIM_EN_FEATURE_CLOCK
+
+#include "../include/simcom.h"
+#include "../include/simcom/core.h"
+#include "../include/simcom/utils.h"
+#include <string.h>
+
+// the anchor is moved forward before the elapsed ticks turn negative
+#define SIM_CLOCK_REBASE_TICKS      0x80000000UL
+
+// ms between +CCLK queries while waiting for the next second
+#define SIM_CLOCK_EDGE_STEP         20
+
+// a sync off by more than this rate is a step of the reference, not drift
+#define SIM_CLOCK_MAX_DRIFT         20000000LL    // ppb
+
+// drift is taken from samples far enough apart to resolve it this well
+#define SIM_CLOCK_DRIFT_RESOLUTION  10000LL       // ppb
+
+static SIM_Status_t readClock(SIM_Clock_HandlerTypeDef*, uint64_t *epochMs, int8_t *timezone);
+static uint64_t project(uint64_t epochMs, uint32_t syncTick, int32_t drift, uint32_t tick);
+static void addSample(SIM_Clock_HandlerTypeDef*, uint64_t epochMs, uint32_t tick, uint16_t errMs);
+static void rebase(SIM_Clock_HandlerTypeDef*, uint32_t tick);
+
+
+SIM_Status_t SIM_Clock_Init(SIM_Clock_HandlerTypeDef *hclk, void *hsim)
+{
+  if (((SIM_HandlerTypeDef*)hsim)->key != SIM_KEY)
+    return SIM_ERROR;
+
+  hclk->hsim = hsim;
+  hclk->seq = 0;
+  hclk->isSynced = 0;
+  hclk->timezone = 0;
+  hclk->drift = 0;
+  hclk->epochMs = 0;
+  hclk->syncTick = 0;
+  hclk->lastSync = ((SIM_HandlerTypeDef*)hsim)->getTick() - SIM_CLOCK_RETRY_INTERVAL;
+  hclk->resyncInterval = SIM_CLOCK_RESYNC_INTERVAL;
+  hclk->isRetrying = 0;
+  hclk->numOfSamples = 0;
+
+  return SIM_OK;
+}
+
+
+// +CCLK only counts whole seconds, so the queries go on until the next
+// second begins; that edge pins the time down to a few ms
+SIM_Status_t SIM_Clock_Sync(SIM_Clock_HandlerTypeDef *hclk)
+{
+  SIM_HandlerTypeDef *hsim = hclk->hsim;
+  SIM_Datetime_t dt;
+  uint32_t epoch;
+  uint32_t startTick;
+  uint32_t firstTick;
+
+  startTick = hsim->getTick();
+  hclk->lastSync = startTick;
+  // cleared by SIM_Clock_Set once a time was taken
+  hclk->isRetrying = 1;
+  if (SIM_GetTime(hsim, &dt) != SIM_OK) return SIM_ERROR;
+  firstTick = hsim->getTick();
+
+  // the RTC has not been set by the network or NTP yet
+  if (dt.year < SIM_CLOCK_MIN_YEAR) return SIM_ERROR;
+  epoch = SIM_DatetimeToEpoch(&dt);
+
+#if SIM_CLOCK_EDGE_TIMEOUT > 0
+  {
+    SIM_Datetime_t next;
+    uint32_t sentTick;
+    uint32_t prevSentTick = startTick;
+    uint32_t tick;
+
+    while (!SIM_IsTimeout(hsim, startTick, SIM_CLOCK_EDGE_TIMEOUT)) {
+      hsim->delay(SIM_CLOCK_EDGE_STEP);
+      sentTick = hsim->getTick();
+      if (SIM_GetTime(hsim, &next) != SIM_OK) break;
+      tick = hsim->getTick();
+
+      if (next.second != dt.second) {
+        // the second began after the previous query was sent
+        SIM_Clock_Set(hclk, SIM_DatetimeToEpoch(&next) * 1000ULL, next.timezone,
+                      prevSentTick + (tick - prevSentTick) / 2, (tick - prevSentTick) / 2 + 1);
+        SIM_Debug("[Clock] synced %02u/%02u/%02u %02u:%02u:%02u, drift %ld ppb",
+                  next.year, next.month, next.day, next.hour, next.minute, next.second,
+                  (long) hclk->drift);
+        return SIM_OK;
+      }
+      prevSentTick = sentTick;
+    }
+  }
+#endif /* SIM_CLOCK_EDGE_TIMEOUT > 0 */
+
+  // somewhere within the second shown, taken as its middle
+  SIM_Clock_Set(hclk, epoch * 1000ULL + 500, dt.timezone,
+                startTick + (firstTick - startTick) / 2, 500 + (firstTick - startTick) / 2);
+  SIM_Debug("[Clock] synced %02u/%02u/%02u %02u:%02u:%02u",
+            dt.year, dt.month, dt.day, dt.hour, dt.minute, dt.second);
+  return SIM_OK;
+}
+
+
+// SIM thread; also takes a time known from elsewhere, e.g. GPS, errMs being
+// how far off it may be. The error against the drift-corrected clock sets
+// how long until the next sync.
+void SIM_Clock_Set(SIM_Clock_HandlerTypeDef *hclk, uint64_t epochMs, int8_t timezone,
+                   uint32_t tick, uint16_t errMs)
+{
+  int64_t residual;
+  int64_t elapsed;
+
+  if (hclk->isSynced) {
+    elapsed = (int32_t) (tick - hclk->syncTick);
+    residual = (int64_t) (epochMs - project(hclk->epochMs, hclk->syncTick, hclk->drift, tick));
+    if (residual < 0) residual = -residual;
+    if (elapsed < 0) elapsed = -elapsed;
+
+    if (residual - errMs > elapsed * SIM_CLOCK_MAX_DRIFT / 1000000000LL) {
+      // the reference was stepped, its older samples do not match anymore
+      hclk->numOfSamples = 0;
+      hclk->resyncInterval = SIM_CLOCK_RESYNC_INTERVAL;
+    }
+    else if (residual <= SIM_CLOCK_TARGET_ERROR + errMs) {
+      hclk->resyncInterval = (hclk->resyncInterval > SIM_CLOCK_MAX_RESYNC_INTERVAL / 2)?
+                             SIM_CLOCK_MAX_RESYNC_INTERVAL: hclk->resyncInterval * 2;
+    }
+    else {
+      hclk->resyncInterval = (hclk->resyncInterval / 2 < SIM_CLOCK_RESYNC_INTERVAL)?
+                             SIM_CLOCK_RESYNC_INTERVAL: hclk->resyncInterval / 2;
+    }
+  }
+
+  addSample(hclk, epochMs, tick, errMs);
+  hclk->isRetrying = 0;
+
+  SIM_SEQ_WRITE_BEGIN(hclk->seq);
+  hclk->epochMs = epochMs;
+  hclk->timezone = timezone;
+  hclk->syncTick = tick;
+  hclk->isSynced = 1;
+  SIM_SEQ_WRITE_END(hclk->seq);
+}
+
+
+void SIM_Clock_Loop(SIM_Clock_HandlerTypeDef *hclk)
+{
+  SIM_HandlerTypeDef *hsim = hclk->hsim;
+  uint32_t interval = (hclk->isSynced && !hclk->isRetrying)?
+                      hclk->resyncInterval: SIM_CLOCK_RETRY_INTERVAL;
+
+  if (hclk->isSynced) rebase(hclk, hsim->getTick());
+
+  if (hsim->state != SIM_STATE_ACTIVE) return;
+#if SIM_EN_FEATURE_NTP
+  // once a server is set the resyncs are +CNTP ones, see SIM_NTP_OnSynced
+  if (hclk->isSynced && !hclk->isRetrying && hsim->ntp.server != 0) return;
+#endif /* SIM_EN_FEATURE_NTP */
+#if SIM_EN_FEATURE_ATQUEUE
+  if (SIM_ATQ_IsDataFlowing(&hsim->atq)) return;
+#endif /* SIM_EN_FEATURE_ATQUEUE */
+  if (SIM_CheckTimeout(hsim, hclk->lastSync, interval)) {
+    SIM_Clock_Sync(hclk);
+  }
+}
+
+
+uint8_t SIM_Clock_IsSynced(SIM_Clock_HandlerTypeDef *hclk)
+{
+  return hclk->isSynced;
+}
+
+
+uint32_t SIM_Clock_GetResyncInterval(SIM_Clock_HandlerTypeDef *hclk)
+{
+  return hclk->isSynced? hclk->resyncInterval: SIM_CLOCK_RETRY_INTERVAL;
+}
+
+
+int32_t SIM_Clock_GetDrift(SIM_Clock_HandlerTypeDef *hclk)
+{
+  return hclk->drift;
+}
+
+
+// any thread, no AT command
+SIM_Status_t SIM_Clock_GetEpoch(SIM_Clock_HandlerTypeDef *hclk, uint32_t *epoch)
+{
+  uint64_t epochMs;
+  int8_t timezone;
+
+  if (readClock(hclk, &epochMs, &timezone) != SIM_OK) return SIM_ERROR;
+  *epoch = epochMs / 1000;
+  return SIM_OK;
+}
+
+
+// any thread, no AT command
+SIM_Status_t SIM_Clock_GetEpochMs(SIM_Clock_HandlerTypeDef *hclk, uint64_t *epochMs)
+{
+  int8_t timezone;
+
+  return readClock(hclk, epochMs, &timezone);
+}
+
+
+// local time of the network the modem is registered on
+SIM_Status_t SIM_Clock_GetDatetime(SIM_Clock_HandlerTypeDef *hclk, SIM_Datetime_t *dt)
+{
+  uint64_t epochMs;
+  int8_t timezone;
+
+  if (readClock(hclk, &epochMs, &timezone) != SIM_OK) return SIM_ERROR;
+  SIM_EpochToDatetime(epochMs / 1000, timezone, dt);
+  return SIM_OK;
+}
+
+
+static SIM_Status_t readClock(SIM_Clock_HandlerTypeDef *hclk, uint64_t *epochMs, int8_t *timezone)
+{
+  SIM_HandlerTypeDef *hsim = hclk->hsim;
+  uint32_t seq;
+  uint64_t anchor;
+  uint32_t syncTick;
+  int32_t drift;
+  uint8_t isSynced;
+
+  do {
+    seq = hclk->seq;
+    __sync_synchronize();
+    isSynced = hclk->isSynced;
+    anchor = hclk->epochMs;
+    syncTick = hclk->syncTick;
+    drift = hclk->drift;
+    *timezone = hclk->timezone;
+    __sync_synchronize();
+  } while ((seq & 1) || seq != hclk->seq);
+
+  if (!isSynced) return SIM_ERROR;
+
+  *epochMs = project(anchor, syncTick, drift, hsim->getTick());
+  return SIM_OK;
+}
+
+
+static uint64_t project(uint64_t epochMs, uint32_t syncTick, int32_t drift, uint32_t tick)
+{
+  int64_t elapsed = (int32_t) (tick - syncTick);
+
+  return epochMs + elapsed + elapsed * drift / 1000000000LL;
+}
+
+
+// the drift is measured across the oldest and newest samples, once they are
+// far enough apart for their errors not to matter
+static void addSample(SIM_Clock_HandlerTypeDef *hclk, uint64_t epochMs, uint32_t tick,
+                      uint16_t errMs)
+{
+  SIM_Clock_Sample_t *oldest = &hclk->samples[0];
+  int64_t baseline;
+  int64_t drift;
+
+  if (hclk->numOfSamples == SIM_CLOCK_NUM_OF_SAMPLES) {
+    memmove(&hclk->samples[0], &hclk->samples[1],
+            sizeof(SIM_Clock_Sample_t) * (SIM_CLOCK_NUM_OF_SAMPLES - 1));
+    hclk->numOfSamples--;
+  }
+  hclk->samples[hclk->numOfSamples].tick = tick;
+  hclk->samples[hclk->numOfSamples].errMs = errMs;
+  hclk->samples[hclk->numOfSamples].epochMs = epochMs;
+  hclk->numOfSamples++;
+
+  if (hclk->numOfSamples < 2) return;
+  baseline = (int32_t) (tick - oldest->tick);
+  if (baseline <= 0) return;
+  if ((int64_t) (oldest->errMs + errMs) * 1000000000LL > SIM_CLOCK_DRIFT_RESOLUTION * baseline)
+    return;
+
+  drift = ((int64_t) (epochMs - oldest->epochMs) - baseline) * 1000000000LL / baseline;
+  if (drift > SIM_CLOCK_MAX_DRIFT || drift < -SIM_CLOCK_MAX_DRIFT) return;
+
+  SIM_SEQ_WRITE_BEGIN(hclk->seq);
+  hclk->drift = (int32_t) drift;
+  SIM_SEQ_WRITE_END(hclk->seq);
+}
+
+
+// keeps tick - syncTick far from wrapping when no resync succeeds
+static void rebase(SIM_Clock_HandlerTypeDef *hclk, uint32_t tick)
+{
+  uint64_t epochMs;
+
+  if (tick - hclk->syncTick < SIM_CLOCK_REBASE_TICKS) return;
+
+  epochMs = project(hclk->epochMs, hclk->syncTick, hclk->drift, tick);
+  SIM_SEQ_WRITE_BEGIN(hclk->seq);
+  hclk->epochMs = epochMs;
+  hclk->syncTick = tick;
+  SIM_SEQ_WRITE_END(hclk->seq);
+
+  // the samples are too old to be told apart by 32 bit ticks much longer
+  hclk->numOfSamples = 0;
+}
+
+#endif /* SIM_EN_FEATURE_CLOCK */
@@ -10,6 +10,7 @@
 #if SIM_EN_FEATURE_FILE
 #include "../include/simcom.h"
 #include "../include/simcom/debug.h"
+#include "../include/simcom/utils.h"
 #include <at-command/utils.h>
 #include <string.h>
 
@@ -9,6 +9,8 @@
 #if SIM_EN_FEATURE_GPS
 
 #include "../include/simcom.h"
+#include "../include/simcom/core.h"
+#include "../include/simcom/utils.h"
 #include "../events.h"
 #include <stdlib.h>
 #include <string.h>
@@ -39,6 +41,7 @@ SIM_Status_t SIM_GPS_Init(SIM_GPS_HandlerTypeDef *hsimGps, void *hsim)
   hsimGps->hsim = hsim;
   hsimGps->state = SIM_GPS_STATE_NON_ACTIVE;
   hsimGps->stateTick = 0;
+  hsimGps->nmeaLines = 0;
 
   if (hsimGps->isConfigured != SIM_GPS_CONFIG_KEY) {
     hsimGps->isConfigured = SIM_GPS_CONFIG_KEY;
@@ -60,8 +63,9 @@ void SIM_GPS_SetupConfig(SIM_GPS_HandlerTypeDef *hsimGps, SIM_GPS_Config_t *conf
 
 void SIM_GPS_SetState(SIM_GPS_HandlerTypeDef *hsimGps, uint8_t newState)
 {
+  SIM_TRACE(hsimGps->hsim, SIM_TRACE_MOD_GPS, hsimGps->state, newState, SIM_TRACE_CAUSE_NONE);
   hsimGps->state = newState;
-  ((SIM_HandlerTypeDef*) hsimGps->hsim)->rtos.eventSet(SIM_RTOS_EVT_GPS_NEW_STATE);
+  SIM_EventSet(hsimGps->hsim, SIM_RTOS_EVT_GPS_NEW_STATE);
 }
 
 
@@ -94,54 +98,52 @@ void SIM_GPS_OnNewState(SIM_GPS_HandlerTypeDef *hsimGps)
 
 static SIM_Status_t setConfiguration(SIM_GPS_HandlerTypeDef *hsimGps)
 {
-  SIM_Status_t status = SIM_ERROR;
   SIM_HandlerTypeDef *hsim = hsimGps->hsim;
-  AT_Data_t paramData[2];
+  AT_Data_t paramData[11];
+  SIM_BatchCmd_t cmds[10];
+  uint8_t cmdNb = 0;
 
   // set Accuracy
   AT_DataSetNumber(&paramData[0], hsimGps->config.accuracy);
-  if (AT_Command(&hsim->atCmd, "+CGPSHOR", 1, paramData, 0, 0) != AT_OK) goto endCmd;
+  cmds[cmdNb++] = (SIM_BatchCmd_t) SIM_BatchCmd("+CGPSHOR", 1, &paramData[0]);
 
-  AT_DataSetNumber(&paramData[0], hsimGps->config.outputRate);
-  if (AT_Command(&hsim->atCmd, "+CGPSNMEARATE", 1, paramData, 0, 0) != AT_OK) goto endCmd;
+  AT_DataSetNumber(&paramData[1], hsimGps->config.outputRate);
+  cmds[cmdNb++] = (SIM_BatchCmd_t) SIM_BatchCmd("+CGPSNMEARATE", 1, &paramData[1]);
 
-  AT_DataSetNumber(&paramData[0], hsimGps->config.isAutoDownloadXTRA? 1:0);
-  if (AT_Command(&hsim->atCmd, "+CGPSXDAUTO", 1, paramData, 0, 0) != AT_OK) goto endCmd;
+  AT_DataSetNumber(&paramData[2], hsimGps->config.isAutoDownloadXTRA? 1:0);
+  cmds[cmdNb++] = (SIM_BatchCmd_t) SIM_BatchCmd("+CGPSXDAUTO", 1, &paramData[2]);
 
-  AT_DataSetNumber(&paramData[0], hsimGps->config.reportInterval);
-  AT_DataSetNumber(&paramData[1], hsimGps->config.NMEA);
-  if (AT_Command(&hsim->atCmd, "+CGPSINFOCFG", 2, paramData, 0, 0) != AT_OK) goto endCmd;
+  AT_DataSetNumber(&paramData[3], hsimGps->config.reportInterval);
+  AT_DataSetNumber(&paramData[4], hsimGps->config.NMEA);
+  cmds[cmdNb++] = (SIM_BatchCmd_t) SIM_BatchCmd("+CGPSINFOCFG", 2, &paramData[3]);
 
-  AT_DataSetNumber(&paramData[0], hsimGps->config.MOAGPS_Method);
-  if (AT_Command(&hsim->atCmd, "+CGPSMD", 1, paramData, 0, 0) != AT_OK) goto endCmd;
+  AT_DataSetNumber(&paramData[5], hsimGps->config.MOAGPS_Method);
+  cmds[cmdNb++] = (SIM_BatchCmd_t) SIM_BatchCmd("+CGPSMD", 1, &paramData[5]);
 
   if (hsimGps->config.agpsServer != 0) {
-    AT_DataSetString(&paramData[0], hsimGps->config.agpsServer);
-    if (AT_Command(&hsim->atCmd, "+CGPSURL", 1, paramData, 0, 0) != AT_OK) goto endCmd;
+    AT_DataSetString(&paramData[6], hsimGps->config.agpsServer);
+    cmds[cmdNb++] = (SIM_BatchCmd_t) SIM_BatchCmd("+CGPSURL", 1, &paramData[6]);
 
-    AT_DataSetNumber(&paramData[0], hsimGps->config.isAgpsServerSecure? 1:0);
-    if (AT_Command(&hsim->atCmd, "+CGPSSSL", 1, paramData, 0, 0) != AT_OK) goto endCmd;
+    AT_DataSetNumber(&paramData[7], hsimGps->config.isAgpsServerSecure? 1:0);
+    cmds[cmdNb++] = (SIM_BatchCmd_t) SIM_BatchCmd("+CGPSSSL", 1, &paramData[7]);
   }
 
   switch (hsimGps->config.antenaMode) {
   case SIM_GPS_ANT_ACTIVE:
-    AT_DataSetNumber(&paramData[0], 3050);
-    if (AT_Command(&hsim->atCmd, "+CVAUXV", 1, paramData, 0, 0) != AT_OK) goto endCmd;
-    AT_DataSetNumber(&paramData[0], 1);
-    if (AT_Command(&hsim->atCmd, "+CVAUXS", 1, paramData, 0, 0) != AT_OK) goto endCmd;
+    AT_DataSetNumber(&paramData[8], 3050);
+    cmds[cmdNb++] = (SIM_BatchCmd_t) SIM_BatchCmd("+CVAUXV", 1, &paramData[8]);
+    AT_DataSetNumber(&paramData[9], 1);
+    cmds[cmdNb++] = (SIM_BatchCmd_t) SIM_BatchCmd("+CVAUXS", 1, &paramData[9]);
     break;
 
   case SIM_GPS_ANT_PASSIVE:
   default:
-    AT_DataSetNumber(&paramData[0], 0);
-    if (AT_Command(&hsim->atCmd, "+CVAUXS", 1, paramData, 0, 0) != AT_OK) goto endCmd;
+    AT_DataSetNumber(&paramData[10], 0);
+    cmds[cmdNb++] = (SIM_BatchCmd_t) SIM_BatchCmd("+CVAUXS", 1, &paramData[10]);
     break;
   }
 
-  status = SIM_OK;
-
-endCmd:
-  return status;
+  return SIM_CommandBatch(hsim, cmds, cmdNb);
 }
 
 static SIM_Status_t activate(SIM_GPS_HandlerTypeDef *hsimGps, uint8_t isActivate)
@@ -161,6 +163,7 @@ static void onGetNMEA(void *app, uint8_t *data, uint16_t len)
   *(data+len) = 0;
 
   lwgps_process(&hsim->gps.lwgps, data, len);
+  hsim->gps.nmeaLines++;
 }
 
 #endif /* SIM_EN_FEATURE_GPS */
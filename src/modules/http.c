@@ -20,6 +20,13 @@ static SIM_Status_t request(SIM_HTTP_HandlerTypeDef*,
                             SIM_HTTP_Request_t*,
                             SIM_HTTP_Response_t*,
                             uint32_t timeout);
+static uint8_t claim(SIM_HTTP_HandlerTypeDef*);
+static void setState(SIM_HTTP_HandlerTypeDef*, uint8_t newState, uint8_t cause);
+static SIM_Status_t startRequest(SIM_HTTP_HandlerTypeDef*, SIM_HTTP_Request_t*);
+static SIM_Status_t readContent(SIM_HTTP_HandlerTypeDef*, SIM_HTTP_Response_t*);
+static void asyncFinish(SIM_HTTP_HandlerTypeDef*, SIM_Status_t);
+static void collectSubmitted(SIM_HTTP_HandlerTypeDef*);
+static void notifyState(SIM_HandlerTypeDef*);
 static void onGetResponse(void *app, AT_Data_t *resp);
 static struct AT_BufferReadTo onReadHead(void *app, AT_Data_t *resp);
 static struct AT_BufferReadTo onReadData(void *app, AT_Data_t *resp);
@@ -33,8 +40,14 @@ SIM_Status_t SIM_HTTP_Init(SIM_HTTP_HandlerTypeDef *hsimHttp, void *hsim)
   hsimHttp->hsim = hsim;
   hsimHttp->state = SIM_HTTP_STATE_AVAILABLE;
   hsimHttp->stateTick = 0;
-
-  AT_Data_t *httpActionResp = malloc(sizeof(AT_Data_t)*3);
+  hsimHttp->request = 0;
+  hsimHttp->response = 0;
+  hsimHttp->submitted = 0;
+  hsimHttp->asyncHead = 0;
+  hsimHttp->asyncTail = 0;
+  hsimHttp->current = 0;
+
+  AT_Data_t *httpActionResp = SIM_Malloc(hsim, sizeof(AT_Data_t)*3);
   AT_DataSetNumber(httpActionResp, 0);
   AT_DataSetNumber(httpActionResp+1, 0);
   AT_DataSetNumber(httpActionResp+2, 0);
@@ -43,15 +56,15 @@ SIM_Status_t SIM_HTTP_Init(SIM_HTTP_HandlerTypeDef *hsimHttp, void *hsim)
   AT_On(&((SIM_HandlerTypeDef*)hsim)->atCmd, "+HTTPPOSTFILE",
         (SIM_HandlerTypeDef*) hsim, 3, httpActionResp, onGetResponse);
 
-  AT_Data_t *readHeadResp = malloc(sizeof(AT_Data_t)*2);
-  uint8_t *readHeadRespStr = malloc(8);
+  AT_Data_t *readHeadResp = SIM_Malloc(hsim, sizeof(AT_Data_t)*2);
+  uint8_t *readHeadRespStr = SIM_Malloc(hsim, 8);
   AT_DataSetBuffer(readHeadResp, readHeadRespStr, 8);
   AT_DataSetNumber(readHeadResp+1, 0);
   AT_ReadIntoBufferOn(&((SIM_HandlerTypeDef*)hsim)->atCmd, "+HTTPHEAD",
         (SIM_HandlerTypeDef*) hsim, 2, readHeadResp, onReadHead);
 
-  AT_Data_t *readDataResp = malloc(sizeof(AT_Data_t)*2);
-  uint8_t *readDataRespStr = malloc(8);
+  AT_Data_t *readDataResp = SIM_Malloc(hsim, sizeof(AT_Data_t)*2);
+  uint8_t *readDataRespStr = SIM_Malloc(hsim, 8);
   AT_DataSetBuffer(readDataResp, readDataRespStr, 8);
   AT_DataSetNumber(readDataResp+1, 0);
   AT_ReadIntoBufferOn(&((SIM_HandlerTypeDef*)hsim)->atCmd, "+HTTPREAD",
@@ -79,6 +92,7 @@ SIM_Status_t SIM_HTTP_Get(SIM_HTTP_HandlerTypeDef *hsimHttp,
   req.method  = 0;
   req.httpData = "Test";
   req.httpDataLength = strlen(req.httpData);
+  req.cid     = 0;
   SIM_FILE_MemoryInfo(&hsim->file);
 
   return request(hsimHttp, &req, resp, timeout);
@@ -99,12 +113,120 @@ SIM_Status_t SIM_HTTP_SendRequest(SIM_HTTP_HandlerTypeDef *hsimHttp, char *url,
   req.method  = method;
   req.httpData = httpRequest;
   req.httpDataLength = httpRequestLength;
+  req.cid     = 0;
   SIM_FILE_MemoryInfo(&hsim->file);
 
   return request(hsimHttp, &req, resp, timeout);
 }
 
 
+SIM_Status_t SIM_HTTP_RequestAsync(SIM_HTTP_HandlerTypeDef *hsimHttp, SIM_HTTP_Async_t *async)
+{
+  SIM_HTTP_Async_t *top;
+
+  async->status = SIM_TIMEOUT;
+  async->resp.status = 0;
+  async->resp.err = 0;
+  async->resp.code = 0;
+  async->resp.contentLen = 0;
+
+  top = __atomic_load_n(&hsimHttp->submitted, __ATOMIC_RELAXED);
+  do {
+    async->next = top;
+  } while (!__atomic_compare_exchange_n(&hsimHttp->submitted, &top, async,
+                                        1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+  SIM_EventSet(hsimHttp->hsim, SIM_RTOS_EVT_HTTP_ASYNC);
+  return SIM_OK;
+}
+
+
+void SIM_HTTP_OnNewState(SIM_HTTP_HandlerTypeDef *hsimHttp)
+{
+  SIM_HandlerTypeDef  *hsim = hsimHttp->hsim;
+  SIM_HTTP_Async_t    *async;
+
+  collectSubmitted(hsimHttp);
+
+  if (hsimHttp->current == 0) {
+    if (hsimHttp->asyncHead == 0 || !claim(hsimHttp)) return;
+
+    async = hsimHttp->asyncHead;
+    hsimHttp->asyncHead = async->next;
+    if (hsimHttp->asyncHead == 0) hsimHttp->asyncTail = 0;
+    async->next = 0;
+    hsimHttp->current = async;
+
+    if (hsim->net.state < SIM_NET_STATE_ONLINE) {
+      asyncFinish(hsimHttp, SIM_ERROR);
+      return;
+    }
+
+    hsimHttp->request = &async->req;
+    hsimHttp->response = &async->resp;
+    hsimHttp->stateTick = hsim->getTick();
+    if (startRequest(hsimHttp, &async->req) != SIM_OK) {
+      asyncFinish(hsimHttp, SIM_ERROR);
+    }
+    return;
+  }
+
+  async = hsimHttp->current;
+  switch (hsimHttp->state) {
+  case SIM_HTTP_STATE_GET_RESP:
+    hsimHttp->stateTick = hsim->getTick();
+    if (async->onStatus) async->onStatus(async, async->resp.code, async->resp.contentLen);
+
+    hsimHttp->headLen = 0;
+    if (AT_Command(&hsim->atCmd, "+HTTPHEAD", 0, 0, 0, 0) != AT_OK) {
+      asyncFinish(hsimHttp, SIM_ERROR);
+      break;
+    }
+    if (async->onHead && async->resp.headBuffer != 0)
+      async->onHead(async, async->resp.headBuffer, hsimHttp->headLen);
+
+    if (async->resp.contentLen == 0) {
+      asyncFinish(hsimHttp, SIM_OK);
+    }
+    else if (readContent(hsimHttp, &async->resp) != SIM_OK) {
+      asyncFinish(hsimHttp, SIM_ERROR);
+    }
+    break;
+
+  case SIM_HTTP_STATE_GET_BUF_CONTENT:
+    hsimHttp->stateTick = hsim->getTick();
+    if (async->onData)
+      async->onData(async, async->resp.contentBuffer, hsimHttp->contentBufLen);
+
+    if (async->resp.contentLen - hsimHttp->contentReadLen <= 0) {
+      asyncFinish(hsimHttp, SIM_OK);
+    }
+    else if (readContent(hsimHttp, &async->resp) != SIM_OK) {
+      asyncFinish(hsimHttp, SIM_ERROR);
+    }
+    break;
+
+  default: break;
+  }
+}
+
+
+void SIM_HTTP_Loop(SIM_HTTP_HandlerTypeDef *hsimHttp)
+{
+  SIM_HandlerTypeDef *hsim = hsimHttp->hsim;
+
+  if (hsimHttp->current != 0) {
+    if (SIM_CheckTimeout(hsim, hsimHttp->stateTick, hsimHttp->current->timeout)) {
+      asyncFinish(hsimHttp, SIM_TIMEOUT);
+    }
+  }
+  // picks up requests queued while a blocking request was running
+  else if (hsimHttp->asyncHead != 0 || hsimHttp->submitted != 0) {
+    SIM_HTTP_OnNewState(hsimHttp);
+  }
+}
+
+
 static SIM_Status_t request(SIM_HTTP_HandlerTypeDef *hsimHttp,
                             SIM_HTTP_Request_t *req, SIM_HTTP_Response_t *resp,
                             uint32_t timeout)
@@ -112,18 +234,21 @@ static SIM_Status_t request(SIM_HTTP_HandlerTypeDef *hsimHttp,
   SIM_HandlerTypeDef  *hsim       = hsimHttp->hsim;
   SIM_Status_t        status      = SIM_TIMEOUT;
   uint32_t            notifEvent;
-  AT_Data_t           paramData[3];
+  uint32_t            waitStart;
 
 
-  while (hsimHttp->state != SIM_HTTP_STATE_AVAILABLE) {
-    hsim->delay(10);
-  }
-  hsimHttp->state = SIM_HTTP_STATE_STARTING;
-
   if (hsim->net.state < SIM_NET_STATE_ONLINE) {
     return SIM_ERROR;
   }
 
+  // sleeps until the request in flight, blocking or async, is done
+  waitStart = hsim->getTick();
+  while (!claim(hsimHttp)) {
+    if (SIM_IsTimeout(hsim, waitStart, timeout)) return SIM_TIMEOUT;
+    hsim->rtos.eventWait(SIM_RTOS_EVT_HTTP_RELEASED, &notifEvent,
+                         timeout - (hsim->getTick() - waitStart));
+  }
+
   resp->status            = 0;
   resp->err               = 0;
   resp->code              = 0;
@@ -132,30 +257,121 @@ static SIM_Status_t request(SIM_HTTP_HandlerTypeDef *hsimHttp,
   hsim->http.request  = req;
   hsim->http.response = resp;
 
-  hsim->http.contentBufLen = 0;
-  hsim->http.contentReadLen = 0;
+  hsim->rtos.eventClear(SIM_RTOS_EVT_HTTP_NEW_STATE);
+  if (startRequest(hsimHttp, req) != SIM_OK) goto endCmd;
 
-  if (AT_Command(&hsim->atCmd, "+HTTPINIT", 0, 0, 0, 0) != AT_OK) goto endCmd;
+  while (hsim->rtos.eventWait(SIM_RTOS_EVT_HTTP_NEW_STATE, &notifEvent, timeout) == AT_OK) {
+    if (!SIM_BITS_IS(notifEvent, SIM_RTOS_EVT_HTTP_NEW_STATE)) goto endCmd;
 
-  AT_DataSetString(&paramData[0], "URL");
-  AT_DataSetString(&paramData[1], (char*) req->url);
-  if (AT_Command(&hsim->atCmd, "+HTTPPARA", 2, paramData, 0, 0) != AT_OK) goto endCmd;
+    switch (hsimHttp->state) {
+    case SIM_HTTP_STATE_GET_RESP:
+      if (AT_Command(&hsim->atCmd, "+HTTPHEAD", 0, 0, 0, 0) != AT_OK) goto endCmd;
+      if (resp->contentLen > 0) {
+        goto readContent;
+      }
+      setState(hsimHttp, SIM_HTTP_STATE_GET_BUF_CONTENT, SIM_TRACE_CAUSE_OK);
+      hsim->rtos.eventSet(SIM_RTOS_EVT_HTTP_NEW_STATE);
+      break;
 
+    case SIM_HTTP_STATE_GET_BUF_CONTENT:
+      if (resp->onGetData) {
+        resp->onGetData(resp->contentBuffer, hsimHttp->contentBufLen);
+      }
+      if (resp->contentLen - hsimHttp->contentReadLen > 0) {
+        goto readContent;
+      }
+
+    case SIM_HTTP_STATE_DONE:
+      status = SIM_OK;
+      goto endCmd;
+      break;
+    }
+
+    continue;
+
+  readContent:
+    if (readContent(hsimHttp, resp) != SIM_OK) goto endCmd;
+  }
 
-  hsimHttp->state = SIM_HTTP_STATE_REQUESTING;
-  hsim->rtos.eventClear(SIM_RTOS_EVT_HTTP_NEW_STATE);
+
+endCmd:
+  if (hsimHttp->state > SIM_HTTP_STATE_STARTING) {
+    AT_Command(&hsim->atCmd, "+HTTPTERM", 0, 0, 0, 0);
+  }
+  hsim->http.request  = 0;
+  hsim->http.response = 0;
+  SIM_TRACE(hsim, SIM_TRACE_MOD_HTTP, hsimHttp->state, SIM_HTTP_STATE_AVAILABLE,
+            status == SIM_OK? SIM_TRACE_CAUSE_OK: SIM_TRACE_CAUSE_ERROR);
+  __atomic_store_n(&hsimHttp->state, SIM_HTTP_STATE_AVAILABLE, __ATOMIC_RELEASE);
+  hsim->rtos.eventSet(SIM_RTOS_EVT_HTTP_RELEASED);
+
+  // let the SIM thread run requests queued in the meantime
+  if (hsimHttp->submitted != 0 || hsimHttp->asyncHead != 0) {
+    SIM_EventSet(hsim, SIM_RTOS_EVT_HTTP_ASYNC);
+  }
+  return status;
+}
+
+
+// takes the modem http service, shared by blocking and async requests
+static uint8_t claim(SIM_HTTP_HandlerTypeDef *hsimHttp)
+{
+  uint8_t available = SIM_HTTP_STATE_AVAILABLE;
+
+  if (!__atomic_compare_exchange_n(&hsimHttp->state, &available,
+                                   SIM_HTTP_STATE_STARTING,
+                                   0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    return 0;
+
+  SIM_TRACE(hsimHttp->hsim, SIM_TRACE_MOD_HTTP, SIM_HTTP_STATE_AVAILABLE,
+            SIM_HTTP_STATE_STARTING, SIM_TRACE_CAUSE_USER);
+  return 1;
+}
+
+
+// plain stores, only valid while the service is claimed
+static void setState(SIM_HTTP_HandlerTypeDef *hsimHttp, uint8_t newState, uint8_t cause)
+{
+  SIM_TRACE(hsimHttp->hsim, SIM_TRACE_MOD_HTTP, hsimHttp->state, newState, cause);
+  hsimHttp->state = newState;
+}
+
+
+static SIM_Status_t startRequest(SIM_HTTP_HandlerTypeDef *hsimHttp, SIM_HTTP_Request_t *req)
+{
+  SIM_HandlerTypeDef  *hsim       = hsimHttp->hsim;
+  AT_Data_t           paramData[3];
+
+  hsimHttp->contentBufLen = 0;
+  hsimHttp->contentReadLen = 0;
+  hsimHttp->headLen = 0;
+
+#if SIM_EN_FEATURE_SOCKET
+  // can't move the profile under open sockets
+  if (hsim->socketManager.state != SIM_SOCKMGR_STATE_NET_CLOSE &&
+      hsim->socketManager.cid != (req->cid? req->cid: SIM_NET_DEFAULT_CID))
+    return SIM_ERROR;
+#endif /* SIM_EN_FEATURE_SOCKET */
+  if (SIM_NET_BindContext(&hsim->net, req->cid) != SIM_OK) return SIM_ERROR;
+
+  if (AT_Command(&hsim->atCmd, "+HTTPINIT", 0, 0, 0, 0) != AT_OK) return SIM_ERROR;
+
+  AT_DataSetString(&paramData[0], "URL");
+  AT_DataSetString(&paramData[1], (char*) req->url);
+  setState(hsimHttp, SIM_HTTP_STATE_REQUESTING, SIM_TRACE_CAUSE_USER);
+  if (AT_Command(&hsim->atCmd, "+HTTPPARA", 2, paramData, 0, 0) != AT_OK) return SIM_ERROR;
 
   if (req->httpData != 0 && req->httpDataLength != 0) {
     // preparing file storage
     if (SIM_FILE_ChangeDir(&hsim->file, "E:/modem_http/") != SIM_OK) {
       if (SIM_FILE_ChangeDir(&hsim->file, "E:/") != SIM_OK)
-        goto endCmd;
+        return SIM_ERROR;
 
       if (SIM_FILE_MakeDir(&hsim->file, "modem_http") != SIM_OK)
-        goto endCmd;
+        return SIM_ERROR;
 
       if (SIM_FILE_ChangeDir(&hsim->file, "E:/modem_http/") != SIM_OK)
-        goto endCmd;
+        return SIM_ERROR;
     }
 
     if (SIM_FILE_IsFileExist(&hsim->file, "E:/request.http") == SIM_OK) {
@@ -170,60 +386,95 @@ static SIM_Status_t request(SIM_HTTP_HandlerTypeDef *hsimHttp,
     AT_DataSetString(&paramData[0], "request.http");
     AT_DataSetNumber(&paramData[1], 3);
     AT_DataSetNumber(&paramData[2], req->method);
-    if (AT_Command(&hsim->atCmd, "+HTTPPOSTFILE", 3, paramData, 0, 0) != AT_OK) goto endCmd;
+    if (AT_Command(&hsim->atCmd, "+HTTPPOSTFILE", 3, paramData, 0, 0) != AT_OK) return SIM_ERROR;
 
   } else {
     AT_DataSetNumber(&paramData[0], req->method);
-    if (AT_Command(&hsim->atCmd, "+HTTPACTION", 1, paramData, 0, 0) != AT_OK) goto endCmd;
+    if (AT_Command(&hsim->atCmd, "+HTTPACTION", 1, paramData, 0, 0) != AT_OK) return SIM_ERROR;
   }
 
-  while (hsim->rtos.eventWait(SIM_RTOS_EVT_HTTP_NEW_STATE, &notifEvent, timeout) == AT_OK) {
-    if (!SIM_BITS_IS(notifEvent, SIM_RTOS_EVT_HTTP_NEW_STATE)) goto endCmd;
+#if SIM_EN_FEATURE_USAGE
+  // the url and the body, headers added by the modem are not known here
+  SIM_Usage_Add(&hsim->usage, hsim->net.boundCid, SIM_USAGE_HTTP,
+                strlen(req->url) + ((req->httpData != 0)? req->httpDataLength: 0), 0);
+#endif
+  return SIM_OK;
+}
 
-    switch (hsimHttp->state) {
-    case SIM_HTTP_STATE_GET_RESP:
-      if (AT_Command(&hsim->atCmd, "+HTTPHEAD", 0, 0, 0, 0) != AT_OK) goto endCmd;
-      if (resp->contentLen > 0) {
-        goto readContent;
-      }
-      hsimHttp->state = SIM_HTTP_STATE_GET_BUF_CONTENT;
-      hsim->rtos.eventSet(SIM_RTOS_EVT_HTTP_NEW_STATE);
-      break;
 
-    case SIM_HTTP_STATE_GET_BUF_CONTENT:
-      if (resp->onGetData) {
-        resp->onGetData(resp->contentBuffer, hsimHttp->contentBufLen);
-      }
-      if (resp->contentLen - hsimHttp->contentReadLen > 0) {
-        goto readContent;
-      }
+static SIM_Status_t readContent(SIM_HTTP_HandlerTypeDef *hsimHttp, SIM_HTTP_Response_t *resp)
+{
+  SIM_HandlerTypeDef  *hsim       = hsimHttp->hsim;
+  AT_Data_t           paramData[2];
+  uint16_t            remainingLen = resp->contentLen - hsimHttp->contentReadLen;
 
-    case SIM_HTTP_STATE_DONE:
-      status = SIM_OK;
-      goto endCmd;
-      break;
-    }
+  setState(hsimHttp, SIM_HTTP_STATE_READING_CONTENT, SIM_TRACE_CAUSE_OK);
 
-    continue;
+  AT_DataSetNumber(&paramData[0], 0);
+  AT_DataSetNumber(&paramData[1],
+                   (remainingLen > resp->contentBufferSize)?
+                       resp->contentBufferSize: remainingLen);
+  if (AT_Command(&hsim->atCmd, "+HTTPREAD", 2, paramData, 0, 0) != AT_OK) return SIM_ERROR;
+  return SIM_OK;
+}
 
-  readContent:
-    hsimHttp->state = SIM_HTTP_STATE_READING_CONTENT;
-
-    uint16_t remainingLen = resp->contentLen - hsimHttp->contentReadLen;
-    AT_DataSetNumber(&paramData[0], 0);
-    AT_DataSetNumber(&paramData[1],
-                     (remainingLen > resp->contentBufferSize)?
-                         resp->contentBufferSize: remainingLen);
-    if (AT_Command(&hsim->atCmd, "+HTTPREAD", 2, paramData, 0, 0) != AT_OK) goto endCmd;
-  }
 
+static void asyncFinish(SIM_HTTP_HandlerTypeDef *hsimHttp, SIM_Status_t status)
+{
+  SIM_HandlerTypeDef  *hsim   = hsimHttp->hsim;
+  SIM_HTTP_Async_t    *async  = hsimHttp->current;
 
-endCmd:
   if (hsimHttp->state > SIM_HTTP_STATE_STARTING) {
     AT_Command(&hsim->atCmd, "+HTTPTERM", 0, 0, 0, 0);
   }
-  hsimHttp->state = SIM_HTTP_STATE_AVAILABLE;
-  return status;
+  hsimHttp->current   = 0;
+  hsimHttp->request   = 0;
+  hsimHttp->response  = 0;
+  SIM_TRACE(hsim, SIM_TRACE_MOD_HTTP, hsimHttp->state, SIM_HTTP_STATE_AVAILABLE,
+            status == SIM_OK? SIM_TRACE_CAUSE_OK: SIM_TRACE_CAUSE_ERROR);
+  __atomic_store_n(&hsimHttp->state, SIM_HTTP_STATE_AVAILABLE, __ATOMIC_RELEASE);
+  hsim->rtos.eventSet(SIM_RTOS_EVT_HTTP_RELEASED);
+
+  async->status = status;
+  if (async->onComplete) async->onComplete(async, status);
+
+  if (hsimHttp->submitted != 0 || hsimHttp->asyncHead != 0) {
+    SIM_EventSet(hsim, SIM_RTOS_EVT_HTTP_ASYNC);
+  }
+}
+
+
+static void collectSubmitted(SIM_HTTP_HandlerTypeDef *hsimHttp)
+{
+  SIM_HTTP_Async_t *async = __atomic_exchange_n(&hsimHttp->submitted, 0, __ATOMIC_ACQUIRE);
+  SIM_HTTP_Async_t *fifo = 0;
+  SIM_HTTP_Async_t *next;
+
+  // the stack is newest first, reverse it to keep the submission order
+  while (async != 0) {
+    next = async->next;
+    async->next = fifo;
+    fifo = async;
+    async = next;
+  }
+
+  if (fifo == 0) return;
+  if (hsimHttp->asyncTail == 0)
+    hsimHttp->asyncHead = fifo;
+  else
+    hsimHttp->asyncTail->next = fifo;
+  while (fifo->next != 0) fifo = fifo->next;
+  hsimHttp->asyncTail = fifo;
+}
+
+
+// wakes whoever drives the request in flight
+static void notifyState(SIM_HandlerTypeDef *hsim)
+{
+  if (hsim->http.current != 0)
+    SIM_EventSet(hsim, SIM_RTOS_EVT_HTTP_ASYNC);
+  else
+    hsim->rtos.eventSet(SIM_RTOS_EVT_HTTP_NEW_STATE);
 }
 
 static void onGetResponse(void *app, AT_Data_t *resp)
@@ -238,8 +489,8 @@ static void onGetResponse(void *app, AT_Data_t *resp)
 
   resp++;
   hsim->http.response->contentLen = resp->value.number;
-  hsim->http.state = SIM_HTTP_STATE_GET_RESP;
-  hsim->rtos.eventSet(SIM_RTOS_EVT_HTTP_NEW_STATE);
+  setState(&hsim->http, SIM_HTTP_STATE_GET_RESP, SIM_TRACE_CAUSE_URC);
+  notifyState(hsim);
 }
 
 
@@ -256,6 +507,10 @@ static struct AT_BufferReadTo onReadHead(void *app, AT_Data_t *data)
 
   data++;
   returnBuf.readLen = data->value.number;
+  hsim->http.headLen = data->value.number;
+#if SIM_EN_FEATURE_USAGE
+  SIM_Usage_Add(&hsim->usage, hsim->net.boundCid, SIM_USAGE_HTTP, 0, data->value.number);
+#endif
 
   if (hsim->http.response != 0) {
     returnBuf.buffer = hsim->http.response->headBuffer;
@@ -278,14 +533,17 @@ static struct AT_BufferReadTo onReadData(void *app, AT_Data_t *resp)
 
   if (resp->type == AT_NUMBER && resp->value.number == 0)
   {
-    hsim->http.state = SIM_HTTP_STATE_GET_BUF_CONTENT;
-    hsim->rtos.eventSet(SIM_RTOS_EVT_HTTP_NEW_STATE);
+    setState(&hsim->http, SIM_HTTP_STATE_GET_BUF_CONTENT, SIM_TRACE_CAUSE_URC);
+    notifyState(hsim);
   }
   if (strncmp(flag, "DATA", 4) == 0) {
     resp++;
     returnBuf.readLen = resp->value.number;
     hsim->http.contentReadLen += resp->value.number;
     hsim->http.contentBufLen = resp->value.number;
+#if SIM_EN_FEATURE_USAGE
+    SIM_Usage_Add(&hsim->usage, hsim->net.boundCid, SIM_USAGE_HTTP, 0, resp->value.number);
+#endif
 
     if (hsim->http.response != 0) {
       returnBuf.buffer = hsim->http.response->contentBuffer;
@@ -0,0 +1,94 @@
+/*
+ * memory.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ */
+
+#include "../include/simcom/memory.h"
+#include "../include/simcom.h"
+#include <stdlib.h>
+
+#if SIM_RAM_BUDGET > 0
+_Static_assert(sizeof(SIM_HandlerTypeDef) + (SIM_EN_STATIC_ALLOC? 0: SIM_MEM_POOL_SIZE)
+               <= SIM_RAM_BUDGET, "SIM_HandlerTypeDef exceeds SIM_RAM_BUDGET");
+#endif
+
+#define FEATURE_SIZE(type) sizeof(((SIM_HandlerTypeDef*)0)->type)
+
+static const SIM_Footprint_t footprint[] = {
+#if SIM_EN_FEATURE_NET
+  {"net",     FEATURE_SIZE(net) + SIM_MEM_NET_SIZE},
+#endif
+#if SIM_EN_FEATURE_NTP
+  {"ntp",     FEATURE_SIZE(ntp)},
+#endif
+#if SIM_EN_FEATURE_SOCKET
+  {"socket",  FEATURE_SIZE(socketManager) + SIM_MEM_SOCKET_SIZE},
+#endif
+#if SIM_EN_FEATURE_HTTP
+  {"http",    FEATURE_SIZE(http) + SIM_MEM_HTTP_SIZE},
+#endif
+#if SIM_EN_FEATURE_GPS
+  {"gps",     FEATURE_SIZE(gps)},
+#endif
+#if SIM_EN_FEATURE_FILE
+  {"file",    FEATURE_SIZE(file)},
+#endif
+#if SIM_EN_FEATURE_STATS
+  {"stats",   FEATURE_SIZE(stats)},
+#endif
+#if SIM_EN_FEATURE_ATQUEUE
+  {"atqueue", FEATURE_SIZE(atq)},
+#endif
+#if SIM_EN_FEATURE_TRACE
+  {"trace",   FEATURE_SIZE(trace)},
+#endif
+#if SIM_EN_FEATURE_POWER
+  {"power",   FEATURE_SIZE(power) + SIM_MEM_POWER_SIZE},
+#endif
+#if SIM_EN_FEATURE_WATCHDOG
+  {"watchdog", FEATURE_SIZE(watchdog)},
+#endif
+#if SIM_EN_FEATURE_CLOCK
+  {"clock",   FEATURE_SIZE(clock)},
+#endif
+#if SIM_EN_FEATURE_USAGE
+  {"usage",   FEATURE_SIZE(usage)},
+#endif
+#if SIM_RESP_BUFFER_SIZE > 0 || SIM_CMD_BUFFER_SIZE > 0
+  {"buffers", SIM_RESP_BUFFER_SIZE + SIM_CMD_BUFFER_SIZE},
+#endif
+  {"handler", sizeof(SIM_HandlerTypeDef) + SIM_MEM_CORE_SIZE},
+  {"total",   sizeof(SIM_HandlerTypeDef) + (SIM_EN_STATIC_ALLOC? 0: SIM_MEM_POOL_SIZE)},
+};
+
+
+// pool memory is never given back, only used for storage living as long as
+// the handler
+void* SIM_Malloc(void *hsim, size_t size)
+{
+#if SIM_EN_STATIC_ALLOC
+  SIM_HandlerTypeDef *h = hsim;
+  void *ptr;
+
+  size = SIM_MEM_ALIGN(size);
+  if (h->memPoolUsed + size > sizeof(h->memPool)) return 0;
+
+  ptr = ((uint8_t*) h->memPool) + h->memPoolUsed;
+  h->memPoolUsed += size;
+  return ptr;
+#else
+  (void) hsim;
+  return malloc(size);
+#endif
+}
+
+
+// "handler" is the whole handler with the core URC storage, the other rows are
+// the parts of it taken by each feature plus its URC storage
+uint8_t SIM_MEM_GetFootprint(const SIM_Footprint_t **table)
+{
+  *table = footprint;
+  return sizeof(footprint) / sizeof(footprint[0]);
+}
@@ -10,10 +10,24 @@
 
 #include "../events.h"
 #include "../include/simcom.h"
+#include "../include/simcom/core.h"
 #include "../include/simcom/utils.h"
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 
+static void setState(SIM_NET_HandlerTypeDef*, uint8_t newState, uint8_t cause);
+static SIM_Status_t activatePDP(SIM_NET_HandlerTypeDef*);
+static SIM_Status_t redefinePDP(SIM_NET_HandlerTypeDef*);
+static uint8_t isSameStr(const char *a, const char *b);
+static SIM_NET_PDP_t* findPDP(SIM_NET_HandlerTypeDef*, uint8_t cid);
+static void storeAddress(SIM_NET_PDP_t*, const char *addr);
+#if SIM_EN_URC_REGISTRATION
+static void onGPRSRegistration(void *app, AT_Data_t*);
+static void onEPSRegistration(void *app, AT_Data_t*);
+static void updatePSRegistration(SIM_NET_HandlerTypeDef*);
+#endif
+
 
 SIM_Status_t SIM_NET_Init(SIM_NET_HandlerTypeDef *hsimnet, void *hsim)
 {
@@ -24,7 +38,18 @@ SIM_Status_t SIM_NET_Init(SIM_NET_HandlerTypeDef *hsimnet, void *hsim)
   hsimnet->status       = 0;
   hsimnet->events       = 0;
   hsimnet->gprs_status  = 0;
+  hsimnet->eps_status   = 0;
   hsimnet->state        = SIM_NET_STATE_NON_ACTIVE;
+  hsimnet->activateTick = 0;
+  hsimnet->boundCid     = 0;
+  memset(hsimnet->pdp, 0, sizeof(hsimnet->pdp));
+
+#if SIM_EN_URC_REGISTRATION
+  AT_On(&((SIM_HandlerTypeDef*)hsim)->atCmd, "+CGREG", (SIM_HandlerTypeDef*) hsim,
+        4, SIM_NewRegistrationResp(hsim), onGPRSRegistration);
+  AT_On(&((SIM_HandlerTypeDef*)hsim)->atCmd, "+CEREG", (SIM_HandlerTypeDef*) hsim,
+        4, SIM_NewRegistrationResp(hsim), onEPSRegistration);
+#endif /* SIM_EN_URC_REGISTRATION */
 
   return SIM_OK;
 }
@@ -32,21 +57,144 @@ SIM_Status_t SIM_NET_Init(SIM_NET_HandlerTypeDef *hsimnet, void *hsim)
 
 void SIM_NET_SetupAPN(SIM_NET_HandlerTypeDef *hsimnet, char *APN, char *user, char *pass)
 {
-  hsimnet->APN.APN   = APN;
-  hsimnet->APN.user  = 0;
-  hsimnet->APN.pass  = 0;
+  SIM_NET_SetupPDP(hsimnet, SIM_NET_DEFAULT_CID, APN, user, pass);
+}
+
+
+// every configured context is defined and activated once the packet domain is up
+SIM_Status_t SIM_NET_SetupPDP(SIM_NET_HandlerTypeDef *hsimnet, uint8_t cid,
+                              char *APN, char *user, char *pass)
+{
+  SIM_NET_PDP_t *pdp = 0;
+
+  if (cid == 0) return SIM_ERROR;
+  for (uint8_t i = 0; i < SIM_NET_PDP_NUM; i++) {
+    if (hsimnet->pdp[i].cid == cid) {
+      pdp = &hsimnet->pdp[i];
+      break;
+    }
+    if (pdp == 0 && hsimnet->pdp[i].cid == 0)
+      pdp = &hsimnet->pdp[i];
+  }
+  if (pdp == 0) return SIM_ERROR;
+
+  if (user != NULL && strlen(user) == 0) user = 0;
+  if (pass != NULL && strlen(pass) == 0) pass = 0;
+
+  // the same setup again leaves an active context alone
+  if (pdp->cid == cid && isSameStr(pdp->APN, APN) &&
+      isSameStr(pdp->user, user) && isSameStr(pdp->pass, pass))
+    return SIM_OK;
 
-  if (strlen(user) > 0)
-    hsimnet->APN.user = user;
-  if (strlen(pass) > 0)
-    hsimnet->APN.pass = pass;
+  if (pdp->cid != cid) pdp->type = SIM_NET_PDP_IP;
+  pdp->cid      = cid;
+  pdp->isActive = 0;
+  pdp->APN      = APN;
+  pdp->user     = user;
+  pdp->pass     = pass;
+
+  // while online the retry of SIM_NET_Loop defines it and brings it up
+  SIM_UNSET_STATUS(hsimnet, SIM_NET_STATUS_APN_WAS_SET);
+  return SIM_OK;
+}
+
+
+// after SIM_NET_SetupPDP, the type is sent with the next +CGDCONT
+SIM_Status_t SIM_NET_SetPDPType(SIM_NET_HandlerTypeDef *hsimnet, uint8_t cid, uint8_t type)
+{
+  SIM_NET_PDP_t *pdp = findPDP(hsimnet, cid);
+
+  if (pdp == 0 || type > SIM_NET_PDP_IPV4V6) return SIM_ERROR;
+  if (pdp->type == type) return SIM_OK;
+
+  // an active context is taken down and up again with the new type
+  pdp->type = type;
+  pdp->isActive = 0;
+  SIM_UNSET_STATUS(hsimnet, SIM_NET_STATUS_APN_WAS_SET);
+  return SIM_OK;
+}
+
+
+uint8_t SIM_NET_IsPDPActive(SIM_NET_HandlerTypeDef *hsimnet, uint8_t cid)
+{
+  SIM_NET_PDP_t *pdp = findPDP(hsimnet, cid);
+
+  return (pdp != 0)? pdp->isActive: 0;
+}
+
+
+const SIM_NET_PDP_t* SIM_NET_GetPDP(SIM_NET_HandlerTypeDef *hsimnet, uint8_t cid)
+{
+  return findPDP(hsimnet, cid);
+}
+
+
+// +CGPADDR: <cid>[,<addr>[,<addr>]], a dual stack context reports both families
+SIM_Status_t SIM_NET_ReadAddress(SIM_NET_HandlerTypeDef *hsimnet, uint8_t cid)
+{
+  SIM_HandlerTypeDef *hsim = hsimnet->hsim;
+  SIM_NET_PDP_t *pdp = findPDP(hsimnet, cid);
+  char respstr[2][64];
+  AT_Data_t paramData[1] = {
+    AT_Number(0),
+  };
+  AT_Data_t respData[3] = {
+    AT_Number(0),
+    AT_Buffer(respstr[0], 64),
+    AT_Buffer(respstr[1], 64),
+  };
+
+  if (pdp == 0) return SIM_ERROR;
+
+  memset(respstr, 0, sizeof(respstr));
+  AT_DataSetNumber(&paramData[0], pdp->cid);
+  if (AT_Command(&hsim->atCmd, "+CGPADDR", 1, paramData, 3, respData) != AT_OK) return SIM_ERROR;
+
+  pdp->ipv4[0] = 0;
+  pdp->ipv6[0] = 0;
+  storeAddress(pdp, respstr[0]);
+  storeAddress(pdp, respstr[1]);
+  return SIM_OK;
+}
+
+
+// the socket stack (NETOPEN) and the http service run on one context at a time
+SIM_Status_t SIM_NET_BindContext(SIM_NET_HandlerTypeDef *hsimnet, uint8_t cid)
+{
+  SIM_HandlerTypeDef *hsim = hsimnet->hsim;
+  AT_Data_t paramData[1] = {
+    AT_Number(0),
+  };
+
+  if (cid == 0) cid = SIM_NET_DEFAULT_CID;
+  if (cid == hsimnet->boundCid) return SIM_OK;
+
+  AT_DataSetNumber(&paramData[0], cid);
+  if (AT_Command(&hsim->atCmd, "+CSOCKSETPN", 1, paramData, 0, 0) != AT_OK) return SIM_ERROR;
+  hsimnet->boundCid = cid;
+  return SIM_OK;
 }
 
 
 void SIM_NET_SetState(SIM_NET_HandlerTypeDef *hsimnet, uint8_t newState)
 {
+  setState(hsimnet, newState, SIM_TRACE_CAUSE_NONE);
+}
+
+static void setState(SIM_NET_HandlerTypeDef *hsimnet, uint8_t newState, uint8_t cause)
+{
+  SIM_TRACE(hsimnet->hsim, SIM_TRACE_MOD_NET, hsimnet->state, newState, cause);
   hsimnet->state = newState;
-  ((SIM_HandlerTypeDef*) hsimnet->hsim)->rtos.eventSet(SIM_RTOS_EVT_NET_NEW_STATE);
+  // contexts are torn down with the packet domain
+  if (newState < SIM_NET_STATE_ONLINE) {
+    for (uint8_t i = 0; i < SIM_NET_PDP_NUM; i++) {
+      hsimnet->pdp[i].isActive = 0;
+      hsimnet->pdp[i].ipv4[0] = 0;
+      hsimnet->pdp[i].ipv6[0] = 0;
+    }
+    hsimnet->boundCid = 0;
+  }
+  SIM_EventSet(hsimnet->hsim, SIM_RTOS_EVT_NET_NEW_STATE);
 }
 
 
@@ -58,18 +206,18 @@ void SIM_NET_OnNewState(SIM_NET_HandlerTypeDef *hsimnet)
 
   switch (hsimnet->state) {
   case SIM_NET_STATE_SETUP_APN:
-    if (hsimnet->APN.APN != NULL) {
+    if (hsimnet->pdp[0].cid != 0) {
       if (SIM_NET_SetAPN(hsimnet) == SIM_OK)
       {
         SIM_Debug("APS was set");
       }
     }
-    SIM_NET_SetState(hsimnet, SIM_NET_STATE_CHECK_GPRS);
+    setState(hsimnet, SIM_NET_STATE_CHECK_GPRS, SIM_TRACE_CAUSE_OK);
     break;
 
   case SIM_NET_STATE_CHECK_GPRS:
     if (!SIM_IS_STATUS(hsimnet, SIM_NET_STATUS_APN_WAS_SET)) {
-      SIM_NET_SetState(hsimnet, SIM_NET_STATE_SETUP_APN);
+      setState(hsimnet, SIM_NET_STATE_SETUP_APN, SIM_TRACE_CAUSE_NONE);
       break;
     }
     SIM_Debug("Checking GPRS...");
@@ -77,13 +225,19 @@ void SIM_NET_OnNewState(SIM_NET_HandlerTypeDef *hsimnet)
       SIM_Debug("GPRS registered%s", (hsimnet->gprs_status == 5)? " (roaming)":"");
     }
     else if (hsimnet->gprs_status == 0) {
-      SIM_NET_SetState(hsimnet, SIM_NET_STATE_SETUP_APN);
+      setState(hsimnet, SIM_NET_STATE_SETUP_APN, SIM_TRACE_CAUSE_ERROR);
     }
     else if (hsim->network_status == 2) {
       SIM_Debug("GPRS Registering....");
     }
     break;
 
+  case SIM_NET_STATE_ONLINE:
+    if (hsim->bootTiming.online == 0)
+      hsim->bootTiming.online = hsim->getTick() - hsim->tick.init;
+    activatePDP(hsimnet);
+    break;
+
   default: break;
   }
 
@@ -97,8 +251,28 @@ void SIM_NET_Loop(SIM_NET_HandlerTypeDef *hsimnet)
 
   switch (hsimnet->state) {
   case SIM_NET_STATE_CHECK_GPRS:
-    if (SIM_IsTimeout(hsim, hsimnet->stateTick, 2000)) {
-      SIM_NET_SetState(hsimnet, SIM_NET_STATE_CHECK_GPRS);
+#if SIM_EN_URC_REGISTRATION
+    // +CGREG/+CEREG URCs move the state, this is only the slow fallback
+    if (SIM_CheckTimeout(hsim, hsimnet->stateTick, SIM_REG_FALLBACK_INTERVAL)) {
+#else
+    if (SIM_CheckTimeout(hsim, hsimnet->stateTick, 2000)) {
+#endif
+      setState(hsimnet, SIM_NET_STATE_CHECK_GPRS, SIM_TRACE_CAUSE_TIMEOUT);
+    }
+    break;
+
+  case SIM_NET_STATE_ONLINE:
+    for (uint8_t i = 0; i < SIM_NET_PDP_NUM; i++) {
+      if (hsimnet->pdp[i].cid != 0 && !hsimnet->pdp[i].isActive) {
+        if (SIM_CheckTimeout(hsim, hsimnet->activateTick, SIM_NET_PDP_RETRY_INTERVAL)) {
+          // a context set up or retyped after attach needs its +CGDCONT first
+          if (SIM_IS_STATUS(hsimnet, SIM_NET_STATUS_APN_WAS_SET) || redefinePDP(hsimnet) == SIM_OK)
+            activatePDP(hsimnet);
+          else
+            hsimnet->activateTick = hsim->getTick();
+        }
+        break;
+      }
     }
     break;
 
@@ -114,34 +288,39 @@ SIM_Status_t SIM_NET_GPRS_Check(SIM_NET_HandlerTypeDef *hsimnet)
   SIM_HandlerTypeDef *hsim = hsimnet->hsim;
   SIM_Status_t status = SIM_ERROR;
 
-  uint8_t lac[2]; // location area code
-  uint8_t ci[2];  // Cell Identify
+  char lac[SIM_CELL_STR_SIZE]; // location area code
+  char ci[SIM_CELL_STR_SIZE];  // Cell Identify
 
-  AT_Data_t respData[4] = {
+  AT_Data_t respData[5] = {
     AT_Number(0),
     AT_Number(0),
-    AT_Hex(lac),
-    AT_Hex(ci),
+    AT_Buffer(lac, SIM_CELL_STR_SIZE),
+    AT_Buffer(ci, SIM_CELL_STR_SIZE),
+    AT_Number(-1),
   };
 
-  memset(lac, 0, 2);
-  memset(ci, 0, 2);
+  memset(lac, 0, SIM_CELL_STR_SIZE);
+  memset(ci, 0, SIM_CELL_STR_SIZE);
 
-  if (AT_Check(&hsim->atCmd, "+CGREG", 4, respData) != AT_OK) return status;
+  if (AT_Check(&hsim->atCmd, "+CGREG", 5, respData) != AT_OK) return status;
   hsimnet->gprs_status = (uint8_t) respData[1].value.number;
+  SIM_OnRegistrationCell(hsim, &respData[1]);
 
   // check response
   if (hsimnet->gprs_status == 1 || hsimnet->gprs_status == 5) {
     status = SIM_OK;
     if (hsimnet->state <= SIM_NET_STATE_CHECK_GPRS) {
-      SIM_NET_SetState(hsimnet, SIM_NET_STATE_ONLINE);
+      setState(hsimnet, SIM_NET_STATE_ONLINE, SIM_TRACE_CAUSE_OK);
     }
     if (hsimnet->gprs_status == 5)
       SIM_SET_STATUS(hsimnet, SIM_NET_STATUS_GPRS_ROAMING);
   }
   else {
-    if (hsimnet->state > SIM_NET_STATE_CHECK_GPRS)
+    if (hsimnet->state > SIM_NET_STATE_CHECK_GPRS) {
+      SIM_TRACE(hsim, SIM_TRACE_MOD_NET, hsimnet->state, SIM_NET_STATE_CHECK_GPRS,
+                SIM_TRACE_CAUSE_ERROR);
       hsimnet->state = SIM_NET_STATE_CHECK_GPRS;
+    }
     SIM_UNSET_STATUS(hsimnet, SIM_NET_STATUS_GPRS_ROAMING);
   }
 
@@ -151,43 +330,199 @@ SIM_Status_t SIM_NET_GPRS_Check(SIM_NET_HandlerTypeDef *hsimnet)
 
 SIM_Status_t SIM_NET_SetAPN(SIM_NET_HandlerTypeDef *hsimnet)
 {
+  static const char *types[] = {"IP", "IPV6", "IPV4V6"};
   SIM_HandlerTypeDef *hsim = hsimnet->hsim;
   SIM_Status_t status = SIM_ERROR;
-  char *APN = hsimnet->APN.APN;
-  char *user = hsimnet->APN.user;
-  char *pass = hsimnet->APN.pass;
-  uint8_t cid = 1;
-  AT_Data_t paramData[4] = {
-    AT_Number(cid),
-    AT_String("IP"),
-    AT_String(APN),
-    AT_String(""),
+  SIM_NET_PDP_t *pdp;
+  AT_Data_t paramData[SIM_NET_PDP_NUM][7];
+  SIM_BatchCmd_t cmds[SIM_NET_PDP_NUM*2];
+  uint8_t cmdNb = 0;
+
+  for (uint8_t i = 0; i < SIM_NET_PDP_NUM; i++) {
+    pdp = &hsimnet->pdp[i];
+    // active ones are already defined, only the contexts added or changed since
+    if (pdp->cid == 0 || pdp->APN == NULL || pdp->isActive) continue;
+
+    AT_DataSetNumber(&paramData[i][0], pdp->cid);
+    AT_DataSetString(&paramData[i][1], types[pdp->type]);
+    AT_DataSetString(&paramData[i][2], pdp->APN);
+    AT_DataSetNumber(&paramData[i][3], pdp->cid);
+    AT_DataSetNumber(&paramData[i][4], 0);
+    AT_DataSetString(&paramData[i][5], "");
+    AT_DataSetString(&paramData[i][6], "");
+    cmds[cmdNb] = (SIM_BatchCmd_t) SIM_BatchCmd("+CGDCONT", 3, &paramData[i][0]);
+    cmds[cmdNb+1] = (SIM_BatchCmd_t) SIM_BatchCmd("+CGAUTH", 2, &paramData[i][3]);
+
+    if (pdp->user != NULL) {
+      AT_DataSetNumber(&paramData[i][4], 3);
+      AT_DataSetString(&paramData[i][5], pdp->user);
+      cmds[cmdNb+1].paramNb = 3;
+
+      if (pdp->pass != NULL) {
+        AT_DataSetString(&paramData[i][6], pdp->pass);
+        cmds[cmdNb+1].paramNb = 4;
+      }
+    }
+    cmdNb += 2;
+  }
+
+  if (cmdNb == 0) goto endCmd;
+  if (SIM_CommandBatch(hsim, cmds, cmdNb) != SIM_OK) goto endCmd;
+
+  SIM_SET_STATUS(hsimnet, SIM_NET_STATUS_APN_WAS_SET);
+  status = SIM_OK;
+
+endCmd:
+  return status;
+}
+
+
+// one +CGACT for every inactive context, the modem sets the data calls up
+// side by side instead of one after the other
+static SIM_Status_t activatePDP(SIM_NET_HandlerTypeDef *hsimnet)
+{
+  SIM_HandlerTypeDef *hsim = hsimnet->hsim;
+  AT_Data_t paramData[SIM_NET_PDP_NUM + 1];
+  uint8_t paramNb = 1;
+
+  AT_DataSetNumber(&paramData[0], 1);
+  for (uint8_t i = 0; i < SIM_NET_PDP_NUM; i++) {
+    if (hsimnet->pdp[i].cid != 0 && !hsimnet->pdp[i].isActive)
+      AT_DataSetNumber(&paramData[paramNb++], hsimnet->pdp[i].cid);
+  }
+  if (paramNb == 1) return SIM_OK;
+
+  hsimnet->activateTick = hsim->getTick();
+  if (AT_Command(&hsim->atCmd, "+CGACT", paramNb, paramData, 0, 0) != AT_OK) {
+    SIM_Debug("PDP activation failed");
+    return SIM_ERROR;
+  }
+
+  for (uint8_t i = 0; i < SIM_NET_PDP_NUM; i++) {
+    if (hsimnet->pdp[i].cid != 0 && !hsimnet->pdp[i].isActive) {
+      hsimnet->pdp[i].isActive = 1;
+      SIM_NET_ReadAddress(hsimnet, hsimnet->pdp[i].cid);
+    }
+  }
+  return SIM_OK;
+}
+
+
+// the modem may still run a changed context on its old definition
+static SIM_Status_t redefinePDP(SIM_NET_HandlerTypeDef *hsimnet)
+{
+  SIM_HandlerTypeDef *hsim = hsimnet->hsim;
+  AT_Data_t paramData[2] = {
+    AT_Number(0),
+    AT_Number(0),
   };
 
-  if (AT_Command(&hsim->atCmd, "+CGDCONT", 3, paramData, 0, 0) != AT_OK) goto endCmd;
+  for (uint8_t i = 0; i < SIM_NET_PDP_NUM; i++) {
+    if (hsimnet->pdp[i].cid == 0 || hsimnet->pdp[i].isActive) continue;
+    if (hsimnet->boundCid == hsimnet->pdp[i].cid) hsimnet->boundCid = 0;
+    // answered with an error when it was not up, nothing to take down then
+    AT_DataSetNumber(&paramData[1], hsimnet->pdp[i].cid);
+    AT_Command(&hsim->atCmd, "+CGACT", 2, paramData, 0, 0);
+  }
+  return SIM_NET_SetAPN(hsimnet);
+}
+
+
+static uint8_t isSameStr(const char *a, const char *b)
+{
+  if (a == 0 || b == 0) return a == b;
+  return strcmp(a, b) == 0;
+}
+
 
-  if (user == NULL) {
-    AT_DataSetNumber(&paramData[1], 0);
-    if (AT_Command(&hsim->atCmd, "+CGAUTH", 2, paramData, 0, 0) != AT_OK) goto endCmd;
+static SIM_NET_PDP_t* findPDP(SIM_NET_HandlerTypeDef *hsimnet, uint8_t cid)
+{
+  if (cid == 0) cid = SIM_NET_DEFAULT_CID;
+  for (uint8_t i = 0; i < SIM_NET_PDP_NUM; i++) {
+    if (hsimnet->pdp[i].cid == cid)
+      return &hsimnet->pdp[i];
   }
-  else {
-    AT_DataSetNumber(&paramData[1], 3);
-    AT_DataSetString(&paramData[2], user);
-    AT_DataSetString(&paramData[3], pass);
+  return 0;
+}
+
+
+// IPv6 comes as 16 dot separated bytes unless +CGPIAF asks for hex groups
+static void storeAddress(SIM_NET_PDP_t *pdp, const char *addr)
+{
+  uint8_t bytes[16];
+  uint8_t dots = 0;
+  char *end;
+  int len = 0;
+
+  for (const char *c = addr; *c; c++) {
+    if (*c == '.') dots++;
+  }
+
+  if (addr[0] == 0 || strcmp(addr, "0.0.0.0") == 0) return;
 
-    if (pass == NULL) {
-      if (AT_Command(&hsim->atCmd, "+CGAUTH", 3, paramData, 0, 0) != AT_OK) goto endCmd;
+  if (strchr(addr, ':') != 0) {
+    strncpy(pdp->ipv6, addr, sizeof(pdp->ipv6) - 1);
+    pdp->ipv6[sizeof(pdp->ipv6) - 1] = 0;
+  }
+  else if (dots == 15) {
+    for (uint8_t i = 0; i < 16; i++) {
+      bytes[i] = (uint8_t) strtoul(addr, &end, 10);
+      addr = end + 1;
+    }
+    for (uint8_t i = 0; i < 16; i += 2) {
+      len += snprintf(pdp->ipv6 + len, sizeof(pdp->ipv6) - len, (i == 0)? "%x": ":%x",
+                      (bytes[i] << 8) | bytes[i+1]);
     }
-    else
-      if (AT_Command(&hsim->atCmd, "+CGAUTH", 4, paramData, 0, 0) != AT_OK) goto endCmd;
   }
+  else if (dots == 3) {
+    strncpy(pdp->ipv4, addr, sizeof(pdp->ipv4) - 1);
+    pdp->ipv4[sizeof(pdp->ipv4) - 1] = 0;
+  }
+}
 
-  SIM_SET_STATUS(hsimnet, SIM_NET_STATUS_APN_WAS_SET);
-  status = SIM_OK;
 
-endCmd:
-  return status;
+#if SIM_EN_URC_REGISTRATION
+static void onGPRSRegistration(void *app, AT_Data_t *resp)
+{
+  SIM_HandlerTypeDef *hsim = (SIM_HandlerTypeDef*)app;
+
+  hsim->net.gprs_status = (uint8_t) resp->value.number;
+  SIM_OnRegistrationCell(hsim, resp);
+  updatePSRegistration(&hsim->net);
+}
+
+static void onEPSRegistration(void *app, AT_Data_t *resp)
+{
+  SIM_HandlerTypeDef *hsim = (SIM_HandlerTypeDef*)app;
+
+  hsim->net.eps_status = (uint8_t) resp->value.number;
+  SIM_OnRegistrationCell(hsim, resp);
+  updatePSRegistration(&hsim->net);
+}
+
+// packet domain is up when either GPRS or EPS reports registered
+static void updatePSRegistration(SIM_NET_HandlerTypeDef *hsimnet)
+{
+  uint8_t isRegistered = hsimnet->gprs_status == 1 || hsimnet->gprs_status == 5 ||
+                         hsimnet->eps_status == 1  || hsimnet->eps_status == 5;
+
+  if (isRegistered) {
+    if (hsimnet->gprs_status == 5 || hsimnet->eps_status == 5) {
+      SIM_SET_STATUS(hsimnet, SIM_NET_STATUS_GPRS_ROAMING);
+    } else {
+      SIM_UNSET_STATUS(hsimnet, SIM_NET_STATUS_GPRS_ROAMING);
+    }
+
+    if (hsimnet->state == SIM_NET_STATE_CHECK_GPRS)
+      setState(hsimnet, SIM_NET_STATE_ONLINE, SIM_TRACE_CAUSE_URC);
+  }
+  else {
+    SIM_UNSET_STATUS(hsimnet, SIM_NET_STATUS_GPRS_ROAMING);
+    if (hsimnet->state == SIM_NET_STATE_ONLINE)
+      setState(hsimnet, SIM_NET_STATE_CHECK_GPRS, SIM_TRACE_CAUSE_URC);
+  }
 }
+#endif /* SIM_EN_URC_REGISTRATION */
 
 
 #endif /* SIM_EN_FEATURE_NET */
@@ -17,6 +17,7 @@
 #include <string.h>
 
 static uint8_t syncNTP(SIM_NTP_HandlerTypeDef*);
+static uint32_t resyncInterval(SIM_NTP_HandlerTypeDef*);
 static void onSynced(void *app, AT_Data_t*);
 
 
@@ -27,7 +28,7 @@ SIM_Status_t SIM_NTP_Init(SIM_NTP_HandlerTypeDef *hsimntp, void *hsim)
 
   hsimntp->hsim = hsim;
   hsimntp->status = 0;
-  hsimntp->config.resyncInterval = 24*3600;
+  hsimntp->config.resyncInterval = 24*3600*1000UL;
   hsimntp->config.retryInterval = 5000;
 
   AT_On(&((SIM_HandlerTypeDef*)hsim)->atCmd, "+CNTP", (SIM_HandlerTypeDef*) hsim, 0, 0, onSynced);
@@ -52,15 +53,18 @@ SIM_Status_t SIM_NTP_Loop(SIM_NTP_HandlerTypeDef *hsimntp)
   SIM_HandlerTypeDef *hsim = hsimntp->hsim;
 
   if (hsim->net.state != SIM_NET_STATE_ONLINE) return SIM_ERROR;
+#if SIM_EN_FEATURE_ATQUEUE
+  if (SIM_ATQ_IsDataFlowing(&hsim->atq)) return SIM_OK;
+#endif /* SIM_EN_FEATURE_ATQUEUE */
   if (!SIM_IS_STATUS(hsimntp, SIM_NTP_SERVER_WAS_SET)) {
     SIM_NTP_SetServer(&hsim->ntp);
   } else {
     if (SIM_IS_STATUS(hsimntp, SIM_NTP_WAS_SYNCED)) {
-      if (hsim->getTick() - hsimntp->syncTick > hsimntp->config.resyncInterval)
+      if (SIM_CheckTimeout(hsim, hsimntp->syncTick, resyncInterval(hsimntp)))
         syncNTP(hsimntp);
     }
     else {
-      if (hsim->getTick() - hsimntp->syncTick > hsimntp->config.retryInterval)
+      if (SIM_CheckTimeout(hsim, hsimntp->syncTick, hsimntp->config.retryInterval))
         syncNTP(hsimntp);
     }
   }
@@ -91,9 +95,18 @@ SIM_Status_t SIM_NTP_OnSynced(SIM_NTP_HandlerTypeDef *hsimntp)
   SIM_HandlerTypeDef *hsim = hsimntp->hsim;
   SIM_Datetime_t dt;
 
+#if SIM_EN_FEATURE_CLOCK
+  // the modem RTC has just been set, re-anchor the local clock to it
+  if (SIM_Clock_Sync(&hsim->clock) == SIM_OK && hsimntp->onSynced != 0
+      && SIM_Clock_GetDatetime(&hsim->clock, &dt) == SIM_OK)
+  {
+    hsimntp->onSynced(dt);
+  }
+#else
   if (hsimntp->onSynced != 0 && SIM_GetTime(hsim, &dt) == SIM_OK) {
     hsimntp->onSynced(dt);
   }
+#endif /* SIM_EN_FEATURE_CLOCK */
 
   return SIM_OK;
 }
@@ -110,6 +123,19 @@ static uint8_t syncNTP(SIM_NTP_HandlerTypeDef *hsimntp)
   return SIM_OK;
 }
 
+// the clock stretches it while its drift estimate holds
+static uint32_t resyncInterval(SIM_NTP_HandlerTypeDef *hsimntp)
+{
+#if SIM_EN_FEATURE_CLOCK
+  SIM_HandlerTypeDef *hsim = hsimntp->hsim;
+  uint32_t interval = SIM_Clock_GetResyncInterval(&hsim->clock);
+
+  return (interval < hsimntp->config.resyncInterval)? interval: hsimntp->config.resyncInterval;
+#else
+  return hsimntp->config.resyncInterval;
+#endif /* SIM_EN_FEATURE_CLOCK */
+}
+
 static void onSynced(void *app, AT_Data_t *_)
 {
   SIM_HandlerTypeDef *hsim = (SIM_HandlerTypeDef*)app;
@@ -118,7 +144,7 @@ static void onSynced(void *app, AT_Data_t *_)
   hsim->events = 0;
   SIM_Debug("[NTP] synced");
   SIM_SET_STATUS(&hsim->ntp, SIM_NTP_WAS_SYNCED);
-  hsim->rtos.eventSet(SIM_RTOS_EVT_NTP_SYNCED);
+  SIM_EventSet(hsim, SIM_RTOS_EVT_NTP_SYNCED);
 }
 
 #endif /* SIM_EN_FEATURE_NTP */
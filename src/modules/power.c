@@ -0,0 +1,369 @@
+/*
+ * power.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ */
+
+#include "../include/simcom/power.h"
+#if SIM_EN_FEATURE_POWER
+
+#include "../include/simcom.h"
+#include "../include/simcom/core.h"
+#include "../include/simcom/utils.h"
+#include "../events.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SIM_PWR_CONFIG_KEY    0xAE
+
+#define SIM_PWR_EVT_RING      0x01
+#define SIM_PWR_EVT_PSM_ENTER 0x02
+#define SIM_PWR_EVT_PSM_EXIT  0x04
+
+typedef struct {
+  uint8_t   bits;     // bits 8 to 6 of the GPRS timer octet
+  uint32_t  unit;     // s
+} TimerUnit_t;
+
+// GPRS Timer 3 (T3412 extended) and GPRS Timer 2 (T3324), 3GPP TS 24.008
+static const TimerUnit_t tauUnits[] = {
+  {3, 2}, {4, 30}, {5, 60}, {0, 600}, {1, 3600}, {2, 36000}, {6, 1152000},
+};
+static const TimerUnit_t activeUnits[] = {
+  {0, 2}, {1, 60}, {2, 360},
+};
+
+static const SIM_PWR_Config_t defaultConfig = {
+  .sleepMode      = SIM_PWR_SLEEP_NONE,
+  .idleTime       = 5000,
+  .psmEnable      = 0,
+  .psmTau         = 3600,
+  .psmActiveTime  = 60,
+  .edrxAct        = SIM_PWR_EDRX_DISABLE,
+  .edrxCycle      = 5,
+};
+
+static void wake(SIM_PWR_HandlerTypeDef*);
+static void enterSleep(SIM_PWR_HandlerTypeDef*);
+static void changeState(SIM_PWR_HandlerTypeDef*, uint8_t newState);
+static void toBits(char *dst, uint8_t value, uint8_t nbits);
+static void encodeTimer(char *dst, uint32_t seconds, const TimerUnit_t*, uint8_t unitNb);
+static void onPSMStatus(void *app, AT_Data_t*);
+
+
+SIM_Status_t SIM_PWR_Init(SIM_PWR_HandlerTypeDef *hpwr, void *hsim)
+{
+  if (((SIM_HandlerTypeDef*)hsim)->key != SIM_KEY)
+    return SIM_ERROR;
+
+  hpwr->hsim = hsim;
+  hpwr->state = SIM_PWR_STATE_ACTIVE;
+  hpwr->events = 0;
+  hpwr->busy = 0;
+  hpwr->isApplied = 0;
+  hpwr->activityTick = ((SIM_HandlerTypeDef*)hsim)->getTick();
+  hpwr->stateTick = hpwr->activityTick;
+  hpwr->reportSeq = 0;
+  memset(&hpwr->report, 0, sizeof(SIM_PWR_Report_t));
+
+  if (hpwr->isConfigured != SIM_PWR_CONFIG_KEY) {
+    hpwr->isConfigured = SIM_PWR_CONFIG_KEY;
+    memcpy(&hpwr->config, &defaultConfig, sizeof(SIM_PWR_Config_t));
+  }
+
+  // +CPSMSTATUS: "ENTER PSM" / "EXIT PSM"
+  AT_Data_t *psmResp = SIM_Malloc(hsim, sizeof(AT_Data_t));
+  uint8_t *psmRespStr = SIM_Malloc(hsim, 16);
+  AT_DataSetBuffer(psmResp, psmRespStr, 16);
+  AT_On(&((SIM_HandlerTypeDef*)hsim)->atCmd, SIM_PWR_PSM_URC,
+        (SIM_HandlerTypeDef*) hsim, 1, psmResp, onPSMStatus);
+
+  return SIM_OK;
+}
+
+
+// applied by the SIM thread once the modem is registered
+void SIM_PWR_Setup(SIM_PWR_HandlerTypeDef *hpwr, const SIM_PWR_Config_t *config)
+{
+  hpwr->isConfigured = SIM_PWR_CONFIG_KEY;
+  memcpy(&hpwr->config, config, sizeof(SIM_PWR_Config_t));
+  hpwr->isApplied = 0;
+  SIM_EventSet(hpwr->hsim, SIM_RTOS_EVT_PWR_WAKE);
+}
+
+
+SIM_Status_t SIM_PWR_Apply(SIM_PWR_HandlerTypeDef *hpwr)
+{
+  SIM_HandlerTypeDef *hsim = hpwr->hsim;
+  AT_Data_t paramData[4];
+  SIM_BatchCmd_t cmds[3];
+  uint8_t cmdNb = 0;
+  char psmLine[40];
+  char tau[9], active[9], cycle[5];
+
+  AT_DataSetNumber(&paramData[0], (hpwr->config.sleepMode == SIM_PWR_SLEEP_DTR)? 1: 0);
+  cmds[cmdNb++] = (SIM_BatchCmd_t) SIM_BatchCmd("+CSCLK", 1, &paramData[0]);
+
+  if (hpwr->config.psmEnable) {
+    // RAU and GPRS READY timers are left to the network
+    encodeTimer(tau, hpwr->config.psmTau, tauUnits, sizeof(tauUnits)/sizeof(tauUnits[0]));
+    encodeTimer(active, hpwr->config.psmActiveTime,
+                activeUnits, sizeof(activeUnits)/sizeof(activeUnits[0]));
+    snprintf(psmLine, sizeof(psmLine), "+CPSMS=1,,,\"%s\",\"%s\"", tau, active);
+    cmds[cmdNb++] = (SIM_BatchCmd_t) SIM_BatchCmd(psmLine, 0, 0);
+  } else {
+    cmds[cmdNb++] = (SIM_BatchCmd_t) SIM_BatchCmd("+CPSMS=0", 0, 0);
+  }
+
+  if (hpwr->config.edrxAct != SIM_PWR_EDRX_DISABLE) {
+    toBits(cycle, hpwr->config.edrxCycle, 4);
+    AT_DataSetNumber(&paramData[1], 1);
+    AT_DataSetNumber(&paramData[2], hpwr->config.edrxAct);
+    AT_DataSetString(&paramData[3], cycle);
+    cmds[cmdNb++] = (SIM_BatchCmd_t) SIM_BatchCmd("+CEDRXS", 3, &paramData[1]);
+  } else {
+    cmds[cmdNb++] = (SIM_BatchCmd_t) SIM_BatchCmd("+CEDRXS=0", 0, 0);
+  }
+
+  // not retried, a modem without PSM or eDRX can still use the DTR sleep
+  hpwr->isApplied = 1;
+  return SIM_CommandBatch(hsim, cmds, cmdNb);
+}
+
+
+// SIM thread, called for every event it receives
+void SIM_PWR_OnEvent(SIM_PWR_HandlerTypeDef *hpwr)
+{
+  SIM_HandlerTypeDef *hsim = hpwr->hsim;
+  uint8_t events = __atomic_exchange_n(&hpwr->events, 0, __ATOMIC_ACQUIRE);
+
+  hpwr->activityTick = hsim->getTick();
+
+  if (events & SIM_PWR_EVT_PSM_ENTER) {
+    if (hsim->rtos.mutexLock(hsim->atCmd.config.timeout) != AT_OK) return;
+    if (hpwr->state != SIM_PWR_STATE_PSM) {
+      changeState(hpwr, SIM_PWR_STATE_PSM);
+    }
+    hsim->rtos.mutexUnlock();
+    return;
+  }
+
+  if (events & SIM_PWR_EVT_PSM_EXIT) {
+    if (hsim->rtos.mutexLock(hsim->atCmd.config.timeout) != AT_OK) return;
+    // the modem is up again, only the DTR line may still hold it asleep
+    if (hpwr->state == SIM_PWR_STATE_PSM) {
+      changeState(hpwr, SIM_PWR_STATE_SLEEP);
+    }
+    hsim->rtos.mutexUnlock();
+  }
+
+  // a URC, a ring or a request of the application
+  SIM_PWR_Wake(hpwr);
+
+  if (!hpwr->isApplied && hsim->state == SIM_STATE_ACTIVE) {
+    SIM_PWR_Apply(hpwr);
+  }
+}
+
+
+// SIM thread, after the other loops
+void SIM_PWR_Loop(SIM_PWR_HandlerTypeDef *hpwr)
+{
+  SIM_HandlerTypeDef *hsim = hpwr->hsim;
+
+  if (hpwr->state != SIM_PWR_STATE_ACTIVE) return;
+  if (hpwr->config.sleepMode != SIM_PWR_SLEEP_DTR || hpwr->setDTR == 0) return;
+  if (!hpwr->isApplied || hsim->state != SIM_STATE_ACTIVE) return;
+#if SIM_EN_FEATURE_HTTP
+  if (hsim->http.state != SIM_HTTP_STATE_AVAILABLE) return;
+#endif
+
+  if (SIM_CheckTimeout(hsim, hpwr->activityTick, hpwr->config.idleTime)) {
+    enterSleep(hpwr);
+  }
+}
+
+
+uint8_t SIM_PWR_IsSleeping(SIM_PWR_HandlerTypeDef *hpwr)
+{
+  return hpwr->state != SIM_PWR_STATE_ACTIVE;
+}
+
+
+// blocks until the modem takes commands again, not for interrupts
+void SIM_PWR_Wake(SIM_PWR_HandlerTypeDef *hpwr)
+{
+  SIM_HandlerTypeDef *hsim = hpwr->hsim;
+
+  hpwr->activityTick = hsim->getTick();
+  if (__atomic_load_n(&hpwr->state, __ATOMIC_SEQ_CST) == SIM_PWR_STATE_ACTIVE) return;
+
+  if (hsim->rtos.mutexLock(hsim->atCmd.config.timeout) != AT_OK) return;
+  wake(hpwr);
+  hsim->rtos.mutexUnlock();
+}
+
+
+// interrupt safe, for the RI line
+void SIM_PWR_OnRing(SIM_PWR_HandlerTypeDef *hpwr)
+{
+  __atomic_fetch_or(&hpwr->events, SIM_PWR_EVT_RING, __ATOMIC_RELEASE);
+  SIM_EventSet(hpwr->hsim, SIM_RTOS_EVT_PWR_WAKE);
+}
+
+
+// AT hook, before every library command
+void SIM_PWR_BeginCommand(SIM_PWR_HandlerTypeDef *hpwr)
+{
+  // pairs with enterSleep: either it sees the command or the command sees
+  // the new state and waits on the mutex for the modem to wake again
+  __atomic_add_fetch(&hpwr->busy, 1, __ATOMIC_SEQ_CST);
+  SIM_PWR_Wake(hpwr);
+}
+
+
+void SIM_PWR_EndCommand(SIM_PWR_HandlerTypeDef *hpwr)
+{
+  SIM_HandlerTypeDef *hsim = hpwr->hsim;
+
+  hpwr->activityTick = hsim->getTick();
+  __atomic_sub_fetch(&hpwr->busy, 1, __ATOMIC_SEQ_CST);
+}
+
+
+// includes the time of the current state
+void SIM_PWR_GetReport(SIM_PWR_HandlerTypeDef *hpwr, SIM_PWR_Report_t *report)
+{
+  SIM_HandlerTypeDef *hsim = hpwr->hsim;
+  uint32_t seq;
+  uint32_t stateTick;
+  uint8_t state;
+
+  do {
+    seq = hpwr->reportSeq;
+    __sync_synchronize();
+    memcpy(report, &hpwr->report, sizeof(SIM_PWR_Report_t));
+    stateTick = hpwr->stateTick;
+    state = hpwr->state;
+    __sync_synchronize();
+  } while ((seq & 1) || seq != hpwr->reportSeq);
+
+  report->time[state] += hsim->getTick() - stateTick;
+}
+
+
+void SIM_PWR_ResetReport(SIM_PWR_HandlerTypeDef *hpwr)
+{
+  SIM_HandlerTypeDef *hsim = hpwr->hsim;
+
+  if (hsim->rtos.mutexLock(hsim->atCmd.config.timeout) != AT_OK) return;
+  SIM_SEQ_WRITE_BEGIN(hpwr->reportSeq);
+  memset(&hpwr->report, 0, sizeof(SIM_PWR_Report_t));
+  hpwr->stateTick = hsim->getTick();
+  SIM_SEQ_WRITE_END(hpwr->reportSeq);
+  hsim->rtos.mutexUnlock();
+}
+
+
+// AT mutex held
+static void wake(SIM_PWR_HandlerTypeDef *hpwr)
+{
+  SIM_HandlerTypeDef *hsim = hpwr->hsim;
+
+  if (hpwr->state == SIM_PWR_STATE_ACTIVE) return;
+
+  if (hpwr->state == SIM_PWR_STATE_PSM && hpwr->wakeup) {
+    hpwr->wakeup();
+    hsim->delay(SIM_PWR_PSM_WAKE_DELAY);
+  }
+  if (hpwr->setDTR) {
+    hpwr->setDTR(0);
+    hsim->delay(SIM_PWR_WAKE_DELAY);
+  }
+
+  changeState(hpwr, SIM_PWR_STATE_ACTIVE);
+  hpwr->report.wakeups++;
+}
+
+
+static void enterSleep(SIM_PWR_HandlerTypeDef *hpwr)
+{
+  SIM_HandlerTypeDef *hsim = hpwr->hsim;
+
+  // waits for a running command, its end counts as activity
+  if (hsim->rtos.mutexLock(hsim->atCmd.config.timeout) != AT_OK) return;
+
+  changeState(hpwr, SIM_PWR_STATE_SLEEP);
+  if (__atomic_load_n(&hpwr->busy, __ATOMIC_SEQ_CST) != 0
+      || !SIM_IsTimeout(hsim, hpwr->activityTick, hpwr->config.idleTime))
+  {
+    changeState(hpwr, SIM_PWR_STATE_ACTIVE);
+    hsim->rtos.mutexUnlock();
+    return;
+  }
+  hpwr->setDTR(1);
+  hsim->rtos.mutexUnlock();
+}
+
+
+// AT mutex held, adds the time of the state that ends
+static void changeState(SIM_PWR_HandlerTypeDef *hpwr, uint8_t newState)
+{
+  SIM_HandlerTypeDef *hsim = hpwr->hsim;
+  uint32_t tick = hsim->getTick();
+
+  SIM_TRACE(hsim, SIM_TRACE_MOD_POWER, hpwr->state, newState, SIM_TRACE_CAUSE_NONE);
+
+  SIM_SEQ_WRITE_BEGIN(hpwr->reportSeq);
+  hpwr->report.time[hpwr->state] += tick - hpwr->stateTick;
+  hpwr->stateTick = tick;
+  __atomic_store_n(&hpwr->state, newState, __ATOMIC_SEQ_CST);
+  SIM_SEQ_WRITE_END(hpwr->reportSeq);
+}
+
+
+static void toBits(char *dst, uint8_t value, uint8_t nbits)
+{
+  for (uint8_t i = 0; i < nbits; i++) {
+    dst[i] = (value & (1 << (nbits - 1 - i)))? '1': '0';
+  }
+  dst[nbits] = 0;
+}
+
+
+// smallest unit that holds the time in 5 bits, rounded up
+static void encodeTimer(char *dst, uint32_t seconds, const TimerUnit_t *units, uint8_t unitNb)
+{
+  uint32_t value = 31;
+  uint8_t i;
+
+  for (i = 0; i < unitNb; i++) {
+    value = (seconds + units[i].unit - 1) / units[i].unit;
+    if (value <= 31) break;
+  }
+  if (i == unitNb) {
+    i = unitNb - 1;
+    value = 31;
+  }
+
+  toBits(dst, (uint8_t) ((units[i].bits << 5) | value), 8);
+}
+
+
+static void onPSMStatus(void *app, AT_Data_t *resp)
+{
+  SIM_HandlerTypeDef *hsim = (SIM_HandlerTypeDef*)app;
+  const char *status = resp->value.string;
+
+  if (strncmp(status, "ENTER", 5) == 0) {
+    __atomic_fetch_or(&hsim->power.events, SIM_PWR_EVT_PSM_ENTER, __ATOMIC_RELEASE);
+  } else if (strncmp(status, "EXIT", 4) == 0) {
+    __atomic_fetch_or(&hsim->power.events, SIM_PWR_EVT_PSM_EXIT, __ATOMIC_RELEASE);
+  } else {
+    return;
+  }
+  SIM_EventSet(hsim, SIM_RTOS_EVT_PWR_WAKE);
+}
+
+#endif /* SIM_EN_FEATURE_POWER */
@@ -24,19 +24,28 @@
 }
 
 
+static void setState(SIM_SocketClient_t *sock, uint8_t newState, uint8_t cause);
 static SIM_Status_t sockOpen(SIM_SocketClient_t *sock);
+static uint8_t hasOtherSocket(SIM_Socket_HandlerTypeDef*, SIM_SocketClient_t *sock);
 static uint8_t isSockConnected(SIM_SocketClient_t *sock);
 static SIM_Status_t sockClose(SIM_SocketClient_t *sock);
+#if SIM_EN_FEATURE_ATQUEUE && SIM_EN_FEATURE_USAGE
+static void onSendDone(SIM_ATQ_Cmd_t*);
+#endif
 
 
+// host is a name, an IPv4 address or an IPv6 address with or without brackets
 SIM_Status_t SIM_SockClient_Init(SIM_SocketClient_t *sock, const char *host, uint16_t port, void *buffer)
 {
-  char *sockIP = sock->host;
-  while (*host != '\0') {
-    *sockIP = *host;
+  size_t len = strlen(host);
+
+  if (len >= 2 && host[0] == '[' && host[len-1] == ']') {
     host++;
-    sockIP++;
+    len -= 2;
   }
+  if (len >= sizeof(sock->host)) return SIM_ERROR;
+  memcpy(sock->host, host, len);
+  sock->host[len] = '\0';
 
   sock->port = port;
 
@@ -51,6 +60,10 @@ SIM_Status_t SIM_SockClient_Init(SIM_SocketClient_t *sock, const char *host, uin
     return SIM_ERROR;
 
   sock->state = SIM_SOCK_CLIENT_STATE_CLOSE;
+#if SIM_EN_FEATURE_USAGE
+  sock->usage.txBytes = 0;
+  sock->usage.rxBytes = 0;
+#endif
   return SIM_OK;
 }
 
@@ -64,25 +77,73 @@ SIM_Status_t SIM_SockClient_OnNetOpened(SIM_SocketClient_t *sock)
 }
 
 
+// the link is gone with the modem, returns 1 when it reopens on the next NETOPEN
+uint8_t SIM_SockClient_OnModemReset(SIM_SocketClient_t *sock)
+{
+  uint8_t wasOpen = (sock->state == SIM_SOCK_CLIENT_STATE_OPEN);
+
+  // closed by the application
+  if (sock->state == SIM_SOCK_CLIENT_STATE_CLOSE && sock->tick.reconnDelay == 0) return 0;
+
+  sock->events = 0;
+  setState(sock, SIM_SOCK_CLIENT_STATE_WAIT_NETOPEN, SIM_TRACE_CAUSE_RESET);
+  if (wasOpen && sock->listeners.onClosed) sock->listeners.onClosed();
+  return 1;
+}
+
+
+// fallback for events which didn't fit in the socket manager queue
 SIM_Status_t SIM_SockClient_CheckEvents(SIM_SocketClient_t *sock)
 {
-  SIM_HandlerTypeDef *hsim = sock->socketManager->hsim;
+  SIM_SockEvent_t evt = {.linkNum = sock->linkNum, .status = 0};
 
   if (SIM_BITS_IS(sock->events, SIM_SOCK_EVENT_ON_OPENED)) {
     SIM_BITS_UNSET(sock->events, SIM_SOCK_EVENT_ON_OPENED);
-    if (sock->listeners.onConnected) sock->listeners.onConnected();
+    evt.kind = SIM_SOCK_EVT_OPENED;
+    SIM_SockClient_OnEvent(sock, &evt);
+  }
+  if (SIM_BITS_IS(sock->events, SIM_SOCK_EVENT_ON_OPENING_ERROR)) {
+    SIM_BITS_UNSET(sock->events, SIM_SOCK_EVENT_ON_OPENING_ERROR);
+    evt.kind = SIM_SOCK_EVT_OPEN_ERROR;
+    SIM_SockClient_OnEvent(sock, &evt);
   }
   if (SIM_BITS_IS(sock->events, SIM_SOCK_EVENT_ON_CLOSED)) {
     SIM_BITS_UNSET(sock->events, SIM_SOCK_EVENT_ON_CLOSED);
+    evt.kind = SIM_SOCK_EVT_CLOSED;
+    SIM_SockClient_OnEvent(sock, &evt);
+  }
+  return SIM_OK;
+}
+
+
+void SIM_SockClient_OnEvent(SIM_SocketClient_t *sock, const SIM_SockEvent_t *evt)
+{
+  SIM_HandlerTypeDef *hsim = sock->socketManager->hsim;
+
+  switch (evt->kind) {
+  case SIM_SOCK_EVT_OPENED:
+    if (sock->listeners.onConnected) sock->listeners.onConnected();
+    break;
+
+  case SIM_SOCK_EVT_OPEN_ERROR:
+    // retried after the reconnecting delay like a closed socket
+    setState(sock, SIM_SOCK_CLIENT_STATE_CLOSE, SIM_TRACE_CAUSE_ERROR);
+    sock->tick.reconnDelay = hsim->getTick();
+    if (sock->listeners.onConnectError) sock->listeners.onConnectError();
+    break;
+
+  case SIM_SOCK_EVT_CLOSED:
     if (sock->state == SIM_SOCK_CLIENT_STATE_OPEN_PENDING) {
       sockOpen(sock);
     } else {
-      sock->state = SIM_SOCK_CLIENT_STATE_CLOSE;
+      setState(sock, SIM_SOCK_CLIENT_STATE_CLOSE, SIM_TRACE_CAUSE_URC);
       sock->tick.reconnDelay = hsim->getTick();
       if (sock->listeners.onClosed) sock->listeners.onClosed();
     }
+    break;
+
+  default: break;
   }
-  return SIM_OK;
 }
 
 
@@ -96,8 +157,8 @@ SIM_Status_t SIM_SockClient_Loop(SIM_SocketClient_t *sock)
     break;
 
   case SIM_SOCK_CLIENT_STATE_OPENING:
-    if (sock->tick.connecting && SIM_IsTimeout(hsim, sock->tick.connecting, 30000)) {
-      sock->state = SIM_SOCK_CLIENT_STATE_OPEN_PENDING;
+    if (sock->tick.connecting && SIM_CheckTimeout(hsim, sock->tick.connecting, 30000)) {
+      setState(sock, SIM_SOCK_CLIENT_STATE_OPEN_PENDING, SIM_TRACE_CAUSE_TIMEOUT);
       SIM_SockClient_Close(sock);
     }
     break;
@@ -106,7 +167,7 @@ SIM_Status_t SIM_SockClient_Loop(SIM_SocketClient_t *sock)
     if (sock->tick.reconnDelay == 0) {
 
     }
-    else if (SIM_IsTimeout(hsim, sock->tick.reconnDelay, 2000)) {
+    else if (SIM_CheckTimeout(hsim, sock->tick.reconnDelay, 2000)) {
       sockOpen(sock);
     }
     break;
@@ -126,13 +187,32 @@ void SIM_SockClient_SetBuffer(SIM_SocketClient_t *sock, void *buffer)
 
 SIM_Status_t SIM_SockClient_Open(SIM_SocketClient_t *sock, void *hsim)
 {
+  uint8_t cid = sock->config.cid? sock->config.cid: SIM_NET_DEFAULT_CID;
+
   if (((SIM_HandlerTypeDef*)hsim)->key != SIM_KEY)
     return SIM_ERROR;
 
   sock->linkNum = -1;
   sock->socketManager = &((SIM_HandlerTypeDef*)hsim)->socketManager;
 
-  if (sock->config.autoReconnect) {
+  // NETOPEN serves a single context, the first registered socket picks it
+  // and keeps it while any socket is registered, even before NETOPEN runs
+  if (sock->socketManager->state == SIM_SOCKMGR_STATE_NET_CLOSE &&
+      !hasOtherSocket(sock->socketManager, sock))
+  {
+    sock->socketManager->cid = cid;
+  }
+  else if (sock->socketManager->cid != cid) {
+    SIM_Debug("[Socket] stack is taken by cid %u", sock->socketManager->cid);
+    return SIM_ERROR;
+  }
+
+  // registered at once so the link holds the context while NETOPEN is pending,
+  // a socket opened again keeps its link
+  for (uint8_t i = 0; i < SIM_NUM_OF_SOCKET; i++) {
+    if (sock->socketManager->sockets[i] == sock) sock->linkNum = i;
+  }
+  if (sock->linkNum < 0) {
     Get_Available_LinkNum(sock->socketManager, &(sock->linkNum));
     if (sock->linkNum < 0) return SIM_ERROR;
     sock->socketManager->sockets[sock->linkNum] = sock;
@@ -140,7 +220,7 @@ SIM_Status_t SIM_SockClient_Open(SIM_SocketClient_t *sock, void *hsim)
 
   if (SIM_SockManager_NetOpen(sock->socketManager) != SIM_OK) return SIM_ERROR;
   if (sock->socketManager->state != SIM_SOCKMGR_STATE_NET_OPEN) {
-    sock->state = SIM_SOCK_CLIENT_STATE_WAIT_NETOPEN;
+    setState(sock, SIM_SOCK_CLIENT_STATE_WAIT_NETOPEN, SIM_TRACE_CAUSE_USER);
     return SIM_OK;
   }
 
@@ -171,6 +251,10 @@ uint16_t SIM_SockClient_SendData(SIM_SocketClient_t *sock, uint8_t *data, uint16
 
   if (sock->state != SIM_SOCK_CLIENT_STATE_OPEN) return 0;
 
+#if SIM_EN_FEATURE_ATQUEUE
+  SIM_ATQ_MarkData(&hsim->atq);
+#endif
+
   AT_Data_t paramData[2] = {
       AT_Number(sock->linkNum),
       AT_Number(length),
@@ -183,10 +267,80 @@ uint16_t SIM_SockClient_SendData(SIM_SocketClient_t *sock, uint8_t *data, uint16
     return 0;
   }
 
+#if SIM_EN_FEATURE_USAGE
+  SIM_Usage_Count(&sock->usage, length, 0);
+  SIM_Usage_Add(&hsim->usage, sock->socketManager->cid, SIM_USAGE_SOCKET, length, 0);
+#endif
   return length;
 }
 
 
+#if SIM_EN_FEATURE_ATQUEUE
+// queues +CIPSEND with data priority, cmd->onComplete is called from the SIM
+// thread; cmd and data must stay valid until then
+SIM_Status_t SIM_SockClient_SendDataAsync(SIM_SocketClient_t *sock, SIM_ATQ_Cmd_t *cmd,
+                                          const uint8_t *data, uint16_t length)
+{
+  SIM_HandlerTypeDef *hsim = sock->socketManager->hsim;
+
+  if (sock->state != SIM_SOCK_CLIENT_STATE_OPEN) return SIM_ERROR;
+
+  cmd->priority = SIM_ATQ_PRIO_DATA;
+  cmd->cmd      = "+CIPSEND";
+  cmd->paramNb  = 2;
+  AT_DataSetNumber(&cmd->params[0], sock->linkNum);
+  AT_DataSetNumber(&cmd->params[1], length);
+  cmd->respNb   = 0;
+  cmd->resp     = 0;
+  cmd->data     = data;
+  cmd->dataLen  = length;
+
+#if SIM_EN_FEATURE_USAGE
+  return SIM_ATQ_SubmitHooked(&hsim->atq, cmd, onSendDone, sock);
+#else
+  return SIM_ATQ_Submit(&hsim->atq, cmd);
+#endif
+}
+#endif /* SIM_EN_FEATURE_ATQUEUE */
+
+
+#if SIM_EN_FEATURE_USAGE
+// any thread, payload bytes since SIM_SockClient_Init
+void SIM_SockClient_GetUsage(SIM_SocketClient_t *sock, SIM_Usage_Counter_t *usage)
+{
+  SIM_Usage_Snapshot(&sock->usage, usage);
+}
+#endif /* SIM_EN_FEATURE_USAGE */
+
+
+#if SIM_EN_FEATURE_ATQUEUE && SIM_EN_FEATURE_USAGE
+// SIM thread, only what the modem took is counted
+static void onSendDone(SIM_ATQ_Cmd_t *cmd)
+{
+  SIM_SocketClient_t *sock = cmd->owner;
+  SIM_HandlerTypeDef *hsim = sock->socketManager->hsim;
+
+  if (cmd->status != SIM_OK) return;
+  SIM_Usage_Count(&sock->usage, cmd->dataLen, 0);
+  SIM_Usage_Add(&hsim->usage, sock->socketManager->cid, SIM_USAGE_SOCKET, cmd->dataLen, 0);
+}
+#endif
+
+static void setState(SIM_SocketClient_t *sock, uint8_t newState, uint8_t cause)
+{
+  SIM_TRACE(sock->socketManager->hsim, SIM_TRACE_MOD_SOCKET | ((sock->linkNum & 0x0F) << 4),
+            sock->state, newState, cause);
+  sock->state = newState;
+}
+
+static uint8_t hasOtherSocket(SIM_Socket_HandlerTypeDef *hsimSockMgr, SIM_SocketClient_t *sock)
+{
+  for (uint8_t i = 0; i < SIM_NUM_OF_SOCKET; i++) {
+    if (hsimSockMgr->sockets[i] != 0 && hsimSockMgr->sockets[i] != sock) return 1;
+  }
+  return 0;
+}
+
 static SIM_Status_t sockOpen(SIM_SocketClient_t *sock)
 {
   SIM_HandlerTypeDef *hsim = sock->socketManager->hsim;
@@ -206,18 +360,18 @@ static SIM_Status_t sockOpen(SIM_SocketClient_t *sock)
 
   if (isSockConnected(sock)) {
     sockClose(sock);
-    sock->state = SIM_SOCK_CLIENT_STATE_OPEN_PENDING;
+    setState(sock, SIM_SOCK_CLIENT_STATE_OPEN_PENDING, SIM_TRACE_CAUSE_ERROR);
     return SIM_ERROR;
   }
 
-  sock->state = SIM_SOCK_CLIENT_STATE_OPENING;
+  setState(sock, SIM_SOCK_CLIENT_STATE_OPENING, SIM_TRACE_CAUSE_USER);
   sock->tick.connecting = hsim->getTick();
   if (AT_Command(&hsim->atCmd, "+CIPOPEN", 4, paramData, 0, 0) != AT_OK) {
-    sock->state = SIM_SOCK_CLIENT_STATE_OPEN_PENDING;
+    setState(sock, SIM_SOCK_CLIENT_STATE_OPEN_PENDING, SIM_TRACE_CAUSE_ERROR);
     return SIM_ERROR;
   }
 
-  sock->listeners.onConnecting();
+  if (sock->listeners.onConnecting) sock->listeners.onConnecting();
 
   return SIM_OK;
 }
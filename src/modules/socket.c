@@ -15,12 +15,18 @@
 #include <stdlib.h>
 
 
+static void setState(SIM_Socket_HandlerTypeDef*, uint8_t newState, uint8_t cause);
 static SIM_Status_t netOpen(SIM_Socket_HandlerTypeDef *hsimSockMgr);
 static void onNetOpened(void *app, AT_Data_t*);
 static void onSocketOpened(void *app, AT_Data_t*);
 static void onSocketClosedByCmd(void *app, AT_Data_t*);
 static void onSocketClosed(void *app, AT_Data_t*);
 static struct AT_BufferReadTo onSocketReceived(void *app, AT_Data_t*);
+static void postEvent(SIM_Socket_HandlerTypeDef*, uint8_t kind, uint8_t linkNum,
+                      uint8_t status);
+
+_Static_assert((SIM_SOCK_EVENT_QUEUE_SIZE & (SIM_SOCK_EVENT_QUEUE_SIZE - 1)) == 0,
+               "SIM_SOCK_EVENT_QUEUE_SIZE must be a power of 2");
 
 
 SIM_Status_t SIM_SockManager_Init(SIM_Socket_HandlerTypeDef *hsimSockMgr, void *hsim)
@@ -31,17 +37,24 @@ SIM_Status_t SIM_SockManager_Init(SIM_Socket_HandlerTypeDef *hsimSockMgr, void *
   hsimSockMgr->hsim = hsim;
   hsimSockMgr->state = SIM_SOCKMGR_STATE_NET_CLOSE;
   hsimSockMgr->stateTick = 0;
-
-  AT_Data_t *netOpenResp = malloc(sizeof(AT_Data_t));
+  hsimSockMgr->cid = SIM_NET_DEFAULT_CID;
+  hsimSockMgr->evtQueue.head = 0;
+  hsimSockMgr->evtQueue.tail = 0;
+  hsimSockMgr->evtQueue.overflows = 0;
+  hsimSockMgr->rxPending.linkNum = -1;
+  hsimSockMgr->rxPending.length = 0;
+  memset((void*) hsimSockMgr->evtQueue.ready, 0, SIM_SOCK_EVENT_QUEUE_SIZE);
+
+  AT_Data_t *netOpenResp = SIM_Malloc(hsim, sizeof(AT_Data_t));
   AT_On(&((SIM_HandlerTypeDef*)hsim)->atCmd, "+NETOPEN",
         (SIM_HandlerTypeDef*) hsim, 1, netOpenResp, onNetOpened);
 
 
-  AT_Data_t *socketOpenResp = malloc(sizeof(AT_Data_t)*2);
+  AT_Data_t *socketOpenResp = SIM_Malloc(hsim, sizeof(AT_Data_t)*2);
   AT_On(&((SIM_HandlerTypeDef*)hsim)->atCmd, "+CIPOPEN",
         (SIM_HandlerTypeDef*) hsim, 2, socketOpenResp, onSocketOpened);
 
-  AT_Data_t *socketCloseResp = malloc(sizeof(AT_Data_t)*2);
+  AT_Data_t *socketCloseResp = SIM_Malloc(hsim, sizeof(AT_Data_t)*2);
   AT_On(&((SIM_HandlerTypeDef*)hsim)->atCmd, "+CIPCLOSE",
         (SIM_HandlerTypeDef*) hsim, 2, socketCloseResp, onSocketClosedByCmd);
   AT_On(&((SIM_HandlerTypeDef*)hsim)->atCmd, "+IPCLOSE",
@@ -55,8 +68,14 @@ SIM_Status_t SIM_SockManager_Init(SIM_Socket_HandlerTypeDef *hsimSockMgr, void *
 
 void SIM_SockManager_SetState(SIM_Socket_HandlerTypeDef *hsimSockMgr, uint8_t newState)
 {
+  setState(hsimSockMgr, newState, SIM_TRACE_CAUSE_NONE);
+}
+
+static void setState(SIM_Socket_HandlerTypeDef *hsimSockMgr, uint8_t newState, uint8_t cause)
+{
+  SIM_TRACE(hsimSockMgr->hsim, SIM_TRACE_MOD_SOCKMGR, hsimSockMgr->state, newState, cause);
   hsimSockMgr->state = newState;
-  ((SIM_HandlerTypeDef*) hsimSockMgr->hsim)->rtos.eventSet(SIM_RTOS_EVT_SOCKMGR_NEW_STATE);
+  SIM_EventSet(hsimSockMgr->hsim, SIM_RTOS_EVT_SOCKMGR_NEW_STATE);
 }
 
 
@@ -82,13 +101,52 @@ SIM_Status_t SIM_SockManager_OnNewState(SIM_Socket_HandlerTypeDef *hsimSockMgr)
 
 void SIM_SockManager_CheckSocketsEvents(SIM_Socket_HandlerTypeDef *hsimSockMgr)
 {
-  for (uint8_t i = 0; i < SIM_NUM_OF_SOCKET; i++) {
-    if (hsimSockMgr->sockets[i] != 0) {
-      SIM_SockClient_CheckEvents(hsimSockMgr->sockets[i]);
+  SIM_SockEvent_t evt;
+  uint32_t tail = hsimSockMgr->evtQueue.tail;
+  uint32_t overflows = hsimSockMgr->evtQueue.overflows;
+  uint32_t idx;
+
+  while (tail != __atomic_load_n(&hsimSockMgr->evtQueue.head, __ATOMIC_ACQUIRE)) {
+    idx = tail & (SIM_SOCK_EVENT_QUEUE_SIZE - 1);
+
+    // reserved but not written yet, the producer raises the event again
+    if (!__atomic_load_n(&hsimSockMgr->evtQueue.ready[idx], __ATOMIC_ACQUIRE)) break;
+
+    evt = hsimSockMgr->evtQueue.events[idx];
+    __atomic_store_n(&hsimSockMgr->evtQueue.ready[idx], 0, __ATOMIC_RELAXED);
+    tail++;
+    __atomic_store_n(&hsimSockMgr->evtQueue.tail, tail, __ATOMIC_RELEASE);
+
+    if (hsimSockMgr->sockets[evt.linkNum] != 0)
+      SIM_SockClient_OnEvent(hsimSockMgr->sockets[evt.linkNum], &evt);
+  }
+
+  // events which didn't fit in the queue were kept as bit flags
+  if (overflows != 0) {
+    __atomic_fetch_sub(&hsimSockMgr->evtQueue.overflows, overflows, __ATOMIC_RELAXED);
+    for (uint8_t i = 0; i < SIM_NUM_OF_SOCKET; i++) {
+      if (hsimSockMgr->sockets[i] != 0) {
+        SIM_SockClient_CheckEvents(hsimSockMgr->sockets[i]);
+      }
     }
   }
 }
 
+// AT handler thread, after AT_Process returned the payload of the last
+// +RECEIVE has been read into the socket buffer. The listener runs here,
+// before the next payload can be read into the same buffer.
+void SIM_SockManager_OnATProcessed(SIM_Socket_HandlerTypeDef *hsimSockMgr)
+{
+  SIM_SocketClient_t *sock;
+
+  if (hsimSockMgr->rxPending.linkNum < 0) return;
+
+  sock = hsimSockMgr->sockets[hsimSockMgr->rxPending.linkNum];
+  hsimSockMgr->rxPending.linkNum = -1;
+  if (sock != 0 && sock->listeners.onReceived)
+    sock->listeners.onReceived(sock->buffer, hsimSockMgr->rxPending.length);
+}
+
 // this function will run every tick
 void SIM_SockManager_Loop(SIM_Socket_HandlerTypeDef *hsimSockMgr)
 {
@@ -99,14 +157,14 @@ void SIM_SockManager_Loop(SIM_Socket_HandlerTypeDef *hsimSockMgr)
     break;
 
   case SIM_SOCKMGR_STATE_NET_OPENING:
-    if (SIM_IsTimeout(hsim, hsimSockMgr->stateTick, 60000)) {
-      SIM_SockManager_SetState(&hsim->socketManager, SIM_SOCKMGR_STATE_NET_OPENING);
+    if (SIM_CheckTimeout(hsim, hsimSockMgr->stateTick, 60000)) {
+      setState(hsimSockMgr, SIM_SOCKMGR_STATE_NET_OPENING, SIM_TRACE_CAUSE_TIMEOUT);
     }
     break;
 
   case SIM_SOCKMGR_STATE_NET_OPEN_PENDING:
-    if (SIM_IsTimeout(hsim, hsimSockMgr->stateTick, 5000)) {
-      SIM_SockManager_SetState(&hsim->socketManager, SIM_SOCKMGR_STATE_NET_OPENING);
+    if (SIM_CheckTimeout(hsim, hsimSockMgr->stateTick, 5000)) {
+      setState(hsimSockMgr, SIM_SOCKMGR_STATE_NET_OPENING, SIM_TRACE_CAUSE_TIMEOUT);
     }
     break;
 
@@ -134,7 +192,7 @@ SIM_Status_t SIM_SockManager_CheckNetOpen(SIM_Socket_HandlerTypeDef *hsimSockMgr
   if (AT_Check(&hsim->atCmd, "+NETOPEN", 1, &respData) != AT_OK) return SIM_ERROR;
   if (respData.value.number == 1) {
     if (hsimSockMgr->state != SIM_SOCKMGR_STATE_NET_OPEN) {
-      SIM_SockManager_SetState(&hsim->socketManager, SIM_SOCKMGR_STATE_NET_OPEN);
+      setState(hsimSockMgr, SIM_SOCKMGR_STATE_NET_OPEN, SIM_TRACE_CAUSE_OK);
     }
   }
   return SIM_OK;
@@ -143,25 +201,39 @@ SIM_Status_t SIM_SockManager_CheckNetOpen(SIM_Socket_HandlerTypeDef *hsimSockMgr
 
 SIM_Status_t SIM_SockManager_NetOpen(SIM_Socket_HandlerTypeDef *hsimSockMgr)
 {
-  SIM_HandlerTypeDef *hsim = hsimSockMgr->hsim;
-
   if (hsimSockMgr->state == SIM_SOCKMGR_STATE_NET_OPENING) return SIM_OK;
 
   if (SIM_SockManager_CheckNetOpen(hsimSockMgr) != SIM_OK) return SIM_ERROR;
   if (hsimSockMgr->state == SIM_SOCKMGR_STATE_NET_OPEN) return SIM_OK;
 
-  SIM_SockManager_SetState(&hsim->socketManager, SIM_SOCKMGR_STATE_NET_OPENING);
+  setState(hsimSockMgr, SIM_SOCKMGR_STATE_NET_OPENING, SIM_TRACE_CAUSE_USER);
 
   return SIM_OK;
 }
 
 
+// the modem restarted, returns the links waiting for the next NETOPEN
+uint32_t SIM_SockManager_OnModemReset(SIM_Socket_HandlerTypeDef *hsimSockMgr)
+{
+  uint32_t mask = 0;
+
+  setState(hsimSockMgr, SIM_SOCKMGR_STATE_NET_CLOSE, SIM_TRACE_CAUSE_RESET);
+  for (uint8_t i = 0; i < SIM_NUM_OF_SOCKET; i++) {
+    if (hsimSockMgr->sockets[i] != 0 && SIM_SockClient_OnModemReset(hsimSockMgr->sockets[i]))
+      mask |= 1UL << i;
+  }
+  return mask;
+}
+
+
 static SIM_Status_t netOpen(SIM_Socket_HandlerTypeDef *hsimSockMgr)
 {
   SIM_HandlerTypeDef *hsim = hsimSockMgr->hsim;
 
-  if (AT_Command(&hsim->atCmd, "+NETOPEN", 0, 0, 0, 0) != AT_OK) {
-    SIM_SockManager_SetState(&hsim->socketManager, SIM_SOCKMGR_STATE_NET_OPEN_PENDING);
+  if (SIM_NET_BindContext(&hsim->net, hsimSockMgr->cid) != SIM_OK ||
+      AT_Command(&hsim->atCmd, "+NETOPEN", 0, 0, 0, 0) != AT_OK)
+  {
+    setState(hsimSockMgr, SIM_SOCKMGR_STATE_NET_OPEN_PENDING, SIM_TRACE_CAUSE_ERROR);
     return SIM_ERROR;
   }
 
@@ -174,9 +246,9 @@ static void onNetOpened(void *app, AT_Data_t *resp)
   SIM_HandlerTypeDef *hsim = (SIM_HandlerTypeDef*)app;
 
   if (resp->value.number == 0) {
-    SIM_SockManager_SetState(&hsim->socketManager, SIM_SOCKMGR_STATE_NET_OPEN);
+    setState(&hsim->socketManager, SIM_SOCKMGR_STATE_NET_OPEN, SIM_TRACE_CAUSE_URC);
   } else {
-    SIM_SockManager_SetState(&hsim->socketManager, SIM_SOCKMGR_STATE_NET_OPEN_PENDING);
+    setState(&hsim->socketManager, SIM_SOCKMGR_STATE_NET_OPEN_PENDING, SIM_TRACE_CAUSE_ERROR);
   }
 }
 
@@ -188,12 +260,16 @@ static void onSocketOpened(void *app, AT_Data_t *resp)
   resp++;
   uint8_t err = resp->value.number;
 
+  if (linkNum >= SIM_NUM_OF_SOCKET) return;
   SIM_SocketClient_t *sock = hsim->socketManager.sockets[linkNum];
   if (sock != 0) {
     if (err == 0) {
+      SIM_TRACE(hsim, SIM_TRACE_MOD_SOCKET | (linkNum << 4), sock->state,
+                SIM_SOCK_CLIENT_STATE_OPEN, SIM_TRACE_CAUSE_URC);
       sock->state = SIM_SOCK_CLIENT_STATE_OPEN;
-      SIM_BITS_SET(sock->events, SIM_SOCK_EVENT_ON_OPENED);
-      hsim->rtos.eventSet(SIM_RTOS_EVT_SOCKCLIENT_NEW_EVT);
+      postEvent(&hsim->socketManager, SIM_SOCK_EVT_OPENED, linkNum, 0);
+    } else {
+      postEvent(&hsim->socketManager, SIM_SOCK_EVT_OPEN_ERROR, linkNum, err);
     }
   }
 }
@@ -207,11 +283,11 @@ static void onSocketClosedByCmd(void *app, AT_Data_t *resp)
   resp++;
   uint8_t err = resp->value.number;
 
+  if (linkNum >= SIM_NUM_OF_SOCKET) return;
   SIM_SocketClient_t *sock = hsim->socketManager.sockets[linkNum];
   if (sock != 0) {
     if (err == 0) {
-      SIM_BITS_SET(sock->events, SIM_SOCK_EVENT_ON_CLOSED);
-      hsim->rtos.eventSet(SIM_RTOS_EVT_SOCKCLIENT_NEW_EVT);
+      postEvent(&hsim->socketManager, SIM_SOCK_EVT_CLOSED, linkNum, 0);
     }
   }
 }
@@ -223,11 +299,12 @@ static void onSocketClosed(void *app, AT_Data_t *resp)
   uint8_t linkNum = resp->value.number;
 
   resp++;
+  uint8_t reason = resp->value.number;
 
+  if (linkNum >= SIM_NUM_OF_SOCKET) return;
   SIM_SocketClient_t *sock = hsim->socketManager.sockets[linkNum];
   if (sock != 0) {
-    SIM_BITS_SET(sock->events, SIM_SOCK_EVENT_ON_CLOSED);
-    hsim->rtos.eventSet(SIM_RTOS_EVT_SOCKCLIENT_NEW_EVT);
+    postEvent(&hsim->socketManager, SIM_SOCK_EVT_CLOSED, linkNum, reason);
   }
 }
 
@@ -241,16 +318,69 @@ static struct AT_BufferReadTo onSocketReceived(void *app, AT_Data_t *resp)
   uint8_t linkNum = resp->value.number;
 
   resp++;
-  uint8_t length = resp->value.number;
+  uint16_t length = resp->value.number;
 
-  SIM_SocketClient_t *sock = hsim->socketManager.sockets[linkNum];
+  // the payload before this one is already in its buffer
+  SIM_SockManager_OnATProcessed(&hsim->socketManager);
+
+  SIM_SocketClient_t *sock = (linkNum < SIM_NUM_OF_SOCKET)?
+                             hsim->socketManager.sockets[linkNum]: 0;
   if (sock != 0) {
     returnBuf.buffer = sock->buffer;
+    hsim->socketManager.rxPending.linkNum = linkNum;
+    hsim->socketManager.rxPending.length = length;
+#if SIM_EN_FEATURE_USAGE
+    SIM_Usage_Count(&sock->usage, 0, length);
+#endif
   }
+#if SIM_EN_FEATURE_USAGE
+  // data of an unknown link still went over the air
+  SIM_Usage_Add(&hsim->usage, hsim->socketManager.cid, SIM_USAGE_SOCKET, 0, length);
+#endif
   returnBuf.bufferSize = length;
   returnBuf.readLen = length;
   return returnBuf;
 }
 
 
+
+// called from the AT handler thread; when the queue is full the event falls
+// back to the bit flags of the socket, so it is coalesced but never lost
+static void postEvent(SIM_Socket_HandlerTypeDef *hsimSockMgr, uint8_t kind, uint8_t linkNum,
+                      uint8_t status)
+{
+  SIM_SocketClient_t *sock;
+  SIM_SockEvent_t *evt;
+  uint32_t head = __atomic_load_n(&hsimSockMgr->evtQueue.head, __ATOMIC_RELAXED);
+  uint32_t idx;
+
+  do {
+    if (head - __atomic_load_n(&hsimSockMgr->evtQueue.tail, __ATOMIC_ACQUIRE)
+        >= SIM_SOCK_EVENT_QUEUE_SIZE)
+    {
+      sock = hsimSockMgr->sockets[linkNum];
+      if (kind == SIM_SOCK_EVT_OPENED) {
+        SIM_BITS_SET(sock->events, SIM_SOCK_EVENT_ON_OPENED);
+      } else if (kind == SIM_SOCK_EVT_OPEN_ERROR) {
+        SIM_BITS_SET(sock->events, SIM_SOCK_EVENT_ON_OPENING_ERROR);
+      } else {
+        SIM_BITS_SET(sock->events, SIM_SOCK_EVENT_ON_CLOSED);
+      }
+      __atomic_fetch_add(&hsimSockMgr->evtQueue.overflows, 1, __ATOMIC_RELEASE);
+      SIM_EventSet(hsimSockMgr->hsim, SIM_RTOS_EVT_SOCKCLIENT_NEW_EVT);
+      return;
+    }
+  } while (!__atomic_compare_exchange_n(&hsimSockMgr->evtQueue.head, &head, head + 1,
+                                        1, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+  idx = head & (SIM_SOCK_EVENT_QUEUE_SIZE - 1);
+  evt = &hsimSockMgr->evtQueue.events[idx];
+  evt->kind     = kind;
+  evt->linkNum  = linkNum;
+  evt->status   = status;
+  __atomic_store_n(&hsimSockMgr->evtQueue.ready[idx], 1, __ATOMIC_RELEASE);
+
+  SIM_EventSet(hsimSockMgr->hsim, SIM_RTOS_EVT_SOCKCLIENT_NEW_EVT);
+}
+
 #endif /* SIM_EN_FEATURE_SOCKET */
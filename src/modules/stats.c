@@ -0,0 +1,160 @@
+/*
+ * stats.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ */
+
+#include "../include/simcom/stats.h"
+#if SIM_EN_FEATURE_STATS
+
+#include "../include/simcom.h"
+#include "../include/simcom/utils.h"
+#include <string.h>
+
+enum {
+  SLOT_FREE,
+  SLOT_CLAIMED,
+  SLOT_READY,
+};
+
+static const uint32_t bucketBounds[SIM_STATS_NUM_OF_BUCKETS-1] = {
+  10, 50, 100, 250, 500, 1000, 5000,
+};
+
+static void getName(char *name, const char *cmd, uint8_t isCheck);
+static SIM_Stats_Cmd_t* getEntry(SIM_Stats_HandlerTypeDef*, const char *name);
+
+
+SIM_Status_t SIM_Stats_Init(SIM_Stats_HandlerTypeDef *hsimStats, void *hsim)
+{
+  if (((SIM_HandlerTypeDef*)hsim)->key != SIM_KEY)
+    return SIM_ERROR;
+
+  hsimStats->hsim = hsim;
+  SIM_Stats_Reset(hsimStats);
+
+  return SIM_OK;
+}
+
+
+// called after every AT call, possibly from several threads at once
+void SIM_Stats_Record(SIM_Stats_HandlerTypeDef *hsimStats, const char *cmd, uint8_t isCheck,
+                      uint32_t elapsed, AT_Status_t result)
+{
+  char name[SIM_STATS_CMD_NAME_LEN];
+  SIM_Stats_Cmd_t *entry;
+  uint32_t maxTime;
+  uint8_t bucket = 0;
+
+  getName(name, cmd, isCheck);
+  entry = getEntry(hsimStats, name);
+  if (entry == 0) {
+    __atomic_fetch_add(&hsimStats->dropped, 1, __ATOMIC_RELAXED);
+    return;
+  }
+
+  while (bucket < SIM_STATS_NUM_OF_BUCKETS-1 && elapsed > bucketBounds[bucket]) {
+    bucket++;
+  }
+
+  __atomic_fetch_add(&entry->calls, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&entry->totalTime, elapsed, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&entry->histogram[bucket], 1, __ATOMIC_RELAXED);
+  maxTime = __atomic_load_n(&entry->maxTime, __ATOMIC_RELAXED);
+  while (elapsed > maxTime
+         && !__atomic_compare_exchange_n(&entry->maxTime, &maxTime, elapsed,
+                                         0, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+  if (result == AT_TIMEOUT)
+    __atomic_fetch_add(&entry->timeouts, 1, __ATOMIC_RELAXED);
+  else if (result != AT_OK)
+    __atomic_fetch_add(&entry->errors, 1, __ATOMIC_RELAXED);
+}
+
+
+uint8_t SIM_Stats_Count(SIM_Stats_HandlerTypeDef *hsimStats)
+{
+  uint8_t count = 0;
+
+  for (uint8_t i = 0; i < SIM_STATS_NUM_OF_CMD; i++) {
+    if (hsimStats->slotState[i] == SLOT_READY) count++;
+  }
+  return count;
+}
+
+
+// copies the idx-th recorded command, idx < SIM_Stats_Count()
+SIM_Status_t SIM_Stats_Get(SIM_Stats_HandlerTypeDef *hsimStats, uint8_t idx, SIM_Stats_Cmd_t *dst)
+{
+  for (uint8_t i = 0; i < SIM_STATS_NUM_OF_CMD; i++) {
+    if (hsimStats->slotState[i] != SLOT_READY) continue;
+    if (idx-- == 0) {
+      memcpy(dst, &hsimStats->cmds[i], sizeof(SIM_Stats_Cmd_t));
+      return SIM_OK;
+    }
+  }
+  return SIM_ERROR;
+}
+
+
+void SIM_Stats_Reset(SIM_Stats_HandlerTypeDef *hsimStats)
+{
+  for (uint8_t i = 0; i < SIM_STATS_NUM_OF_CMD; i++) {
+    hsimStats->slotState[i] = SLOT_FREE;
+  }
+  memset(hsimStats->cmds, 0, sizeof(hsimStats->cmds));
+  hsimStats->dropped = 0;
+}
+
+
+static void getName(char *name, const char *cmd, uint8_t isCheck)
+{
+  uint8_t len = 0;
+
+  if (strchr(cmd, ';') != 0) {
+    strcpy(name, "<batch>");
+    return;
+  }
+  if (*cmd == 0) {
+    strcpy(name, "AT");
+    return;
+  }
+
+  while (*cmd && *cmd != '=' && *cmd != '?' && len < SIM_STATS_CMD_NAME_LEN-2) {
+    name[len++] = *cmd++;
+  }
+  if (isCheck) name[len++] = '?';
+  name[len] = 0;
+}
+
+
+static SIM_Stats_Cmd_t* getEntry(SIM_Stats_HandlerTypeDef *hsimStats, const char *name)
+{
+  uint8_t state;
+
+  for (uint8_t i = 0; i < SIM_STATS_NUM_OF_CMD; i++) {
+    state = __atomic_load_n(&hsimStats->slotState[i], __ATOMIC_ACQUIRE);
+
+    // a free slot is claimed, or another thread claimed it first
+    if (state == SLOT_FREE
+        && __atomic_compare_exchange_n(&hsimStats->slotState[i], &state, SLOT_CLAIMED,
+                                       0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+      strncpy(hsimStats->cmds[i].name, name, SIM_STATS_CMD_NAME_LEN);
+      __atomic_store_n(&hsimStats->slotState[i], SLOT_READY, __ATOMIC_RELEASE);
+      return &hsimStats->cmds[i];
+    }
+
+    // the other thread may be adding the same name, wait for it to be published
+    while (state == SLOT_CLAIMED) {
+      state = __atomic_load_n(&hsimStats->slotState[i], __ATOMIC_ACQUIRE);
+    }
+
+    if (strncmp(hsimStats->cmds[i].name, name, SIM_STATS_CMD_NAME_LEN) == 0)
+      return &hsimStats->cmds[i];
+  }
+
+  return 0;
+}
+
+#endif /* SIM_EN_FEATURE_STATS */
@@ -0,0 +1,79 @@
+/*
+ * trace.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ */
+
+#include "../include/simcom/trace.h"
+#if SIM_EN_FEATURE_TRACE
+
+#include "../include/simcom.h"
+#include <string.h>
+
+_Static_assert((SIM_TRACE_SIZE & (SIM_TRACE_SIZE - 1)) == 0,
+               "SIM_TRACE_SIZE must be a power of 2");
+
+
+void SIM_Trace_Init(SIM_Trace_HandlerTypeDef *htrace)
+{
+  htrace->head = 0;
+  memset(htrace->records, 0, sizeof(htrace->records));
+}
+
+
+// called from the SIM and the AT handler threads
+void SIM_Trace_Record(void *hsim, uint8_t module, uint8_t oldState, uint8_t newState,
+                      uint8_t cause)
+{
+  SIM_HandlerTypeDef *h = hsim;
+  uint32_t idx = __atomic_fetch_add(&h->trace.head, 1, __ATOMIC_RELAXED);
+  SIM_TraceRecord_t *rec = &h->trace.records[idx & (SIM_TRACE_SIZE - 1)];
+
+  rec->tick     = h->getTick();
+  rec->module   = module;
+  rec->oldState = oldState;
+  rec->newState = newState;
+  rec->cause    = cause;
+}
+
+
+// copies the newest records, oldest first
+uint16_t SIM_Trace_Read(SIM_Trace_HandlerTypeDef *htrace, SIM_TraceRecord_t *dst, uint16_t max)
+{
+  uint32_t head = htrace->head;
+  uint32_t count = (head > SIM_TRACE_SIZE)? SIM_TRACE_SIZE: head;
+
+  if (count > max) count = max;
+  for (uint32_t i = 0; i < count; i++) {
+    dst[i] = htrace->records[(head - count + i) & (SIM_TRACE_SIZE - 1)];
+  }
+  return (uint16_t) count;
+}
+
+
+// writes a SIM_TraceHeader_t and the records, for tools/trace-decode
+uint32_t SIM_Trace_Dump(SIM_Trace_HandlerTypeDef *htrace,
+                        void (*write)(void *context, const void *data, uint16_t len),
+                        void *context)
+{
+  SIM_TraceHeader_t header;
+  SIM_TraceRecord_t record;
+  uint32_t head = htrace->head;
+  uint32_t count = (head > SIM_TRACE_SIZE)? SIM_TRACE_SIZE: head;
+
+  header.magic      = SIM_TRACE_MAGIC;
+  header.version    = SIM_TRACE_VERSION;
+  header.recordSize = sizeof(SIM_TraceRecord_t);
+  header.count      = (uint16_t) count;
+  header.lost       = head - count;
+  write(context, &header, sizeof(header));
+
+  for (uint32_t i = 0; i < count; i++) {
+    record = htrace->records[(head - count + i) & (SIM_TRACE_SIZE - 1)];
+    write(context, &record, sizeof(record));
+  }
+  return sizeof(header) + count * sizeof(record);
+}
+
+#endif /* SIM_EN_FEATURE_TRACE */
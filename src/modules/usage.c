@@ -0,0 +1,200 @@
+/*
+ * usage.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ */
+
+#include "../include/simcom/usage.h"
+#if SIM_EN_FEATURE_USAGE
+
+#include "../include/simcom.h"
+#include "../include/simcom/utils.h"
+#include <string.h>
+
+static SIM_Usage_Context_t* getContext(SIM_Usage_HandlerTypeDef*, uint8_t cid);
+
+
+SIM_Status_t SIM_Usage_Init(SIM_Usage_HandlerTypeDef *husage, void *hsim)
+{
+  if (((SIM_HandlerTypeDef*)hsim)->key != SIM_KEY)
+    return SIM_ERROR;
+
+  husage->hsim = hsim;
+  husage->seq = 0;
+  husage->lastRead = 0;
+  memset(husage->modemRaw, 0, sizeof(husage->modemRaw));
+  memset(husage->contexts, 0, sizeof(husage->contexts));
+
+  return SIM_OK;
+}
+
+
+// any thread
+void SIM_Usage_Count(SIM_Usage_Counter_t *counter, uint32_t tx, uint32_t rx)
+{
+  if (tx) __atomic_fetch_add(&counter->txBytes, tx, __ATOMIC_RELAXED);
+  if (rx) __atomic_fetch_add(&counter->rxBytes, rx, __ATOMIC_RELAXED);
+}
+
+
+// any thread, bytes of a context which has no free slot left are dropped
+void SIM_Usage_Add(SIM_Usage_HandlerTypeDef *husage, uint8_t cid, uint8_t source,
+                   uint32_t tx, uint32_t rx)
+{
+  SIM_Usage_Context_t *ctx = getContext(husage, cid);
+
+  if (ctx == 0) return;
+  SIM_Usage_Count((source == SIM_USAGE_HTTP)? &ctx->http: &ctx->socket, tx, rx);
+}
+
+
+// polls the modem counters of the active contexts while no data is moving
+void SIM_Usage_Loop(SIM_Usage_HandlerTypeDef *husage)
+{
+#ifdef SIM_USAGE_MODEM_CMD
+  SIM_HandlerTypeDef *hsim = husage->hsim;
+
+  if (hsim->net.state != SIM_NET_STATE_ONLINE) return;
+#if SIM_EN_FEATURE_ATQUEUE
+  if (SIM_ATQ_IsDataFlowing(&hsim->atq)) return;
+#endif /* SIM_EN_FEATURE_ATQUEUE */
+  if (!SIM_CheckTimeout(hsim, husage->lastRead, SIM_USAGE_MODEM_INTERVAL)) return;
+
+  husage->lastRead = hsim->getTick();
+  for (uint8_t i = 0; i < SIM_NET_PDP_NUM; i++) {
+    if (hsim->net.pdp[i].cid != 0 && hsim->net.pdp[i].isActive)
+      SIM_Usage_ReadModem(husage, hsim->net.pdp[i].cid);
+  }
+#else
+  (void) husage;
+#endif /* SIM_USAGE_MODEM_CMD */
+}
+
+
+// SIM thread, folds the modem counters of cid into the totals since the last reset
+SIM_Status_t SIM_Usage_ReadModem(SIM_Usage_HandlerTypeDef *husage, uint8_t cid)
+{
+#ifdef SIM_USAGE_MODEM_CMD
+  SIM_HandlerTypeDef  *hsim = husage->hsim;
+  SIM_Usage_Context_t *ctx;
+  SIM_Usage_Counter_t *raw;
+  uint32_t tx, rx;
+
+  AT_Data_t paramData[1] = {
+      AT_Number(cid),
+  };
+  AT_Data_t respData[3] = {
+      AT_Number(0),
+      AT_Number(0),
+      AT_Number(0),
+  };
+
+  if (AT_Command(&hsim->atCmd, SIM_USAGE_MODEM_CMD, 1, paramData, 3, respData) != AT_OK)
+    return SIM_ERROR;
+  if (respData[0].value.number != cid) return SIM_ERROR;
+
+  ctx = getContext(husage, cid);
+  if (ctx == 0) return SIM_ERROR;
+
+  raw = &husage->modemRaw[ctx - husage->contexts];
+  tx = (uint32_t) respData[1].value.number;
+  rx = (uint32_t) respData[2].value.number;
+
+  SIM_SEQ_WRITE_BEGIN(husage->seq);
+  // the modem starts over when the context is activated again
+  ctx->modem.txBytes += (tx >= raw->txBytes)? tx - raw->txBytes: tx;
+  ctx->modem.rxBytes += (rx >= raw->rxBytes)? rx - raw->rxBytes: rx;
+  ctx->modemTick = hsim->getTick();
+  SIM_SEQ_WRITE_END(husage->seq);
+
+  raw->txBytes = tx;
+  raw->rxBytes = rx;
+  return SIM_OK;
+#else
+  (void) husage;
+  (void) cid;
+  return SIM_ERROR;
+#endif /* SIM_USAGE_MODEM_CMD */
+}
+
+
+// any thread, no AT command
+void SIM_Usage_Snapshot(const SIM_Usage_Counter_t *counter, SIM_Usage_Counter_t *out)
+{
+  out->txBytes = __atomic_load_n(&counter->txBytes, __ATOMIC_RELAXED);
+  out->rxBytes = __atomic_load_n(&counter->rxBytes, __ATOMIC_RELAXED);
+}
+
+
+// any thread, no AT command
+SIM_Status_t SIM_Usage_GetContext(SIM_Usage_HandlerTypeDef *husage, uint8_t cid,
+                                  SIM_Usage_Context_t *out)
+{
+  SIM_Usage_Context_t *ctx = 0;
+  uint32_t seq;
+
+  if (cid == 0) cid = SIM_NET_DEFAULT_CID;
+  for (uint8_t i = 0; i < SIM_NET_PDP_NUM; i++) {
+    if (__atomic_load_n(&husage->contexts[i].cid, __ATOMIC_ACQUIRE) == cid) {
+      ctx = &husage->contexts[i];
+      break;
+    }
+  }
+  if (ctx == 0) return SIM_ERROR;
+
+  do {
+    seq = husage->seq;
+    __sync_synchronize();
+    out->cid = cid;
+    SIM_Usage_Snapshot(&ctx->socket, &out->socket);
+    SIM_Usage_Snapshot(&ctx->http, &out->http);
+    out->modem = ctx->modem;
+    out->modemTick = ctx->modemTick;
+    __sync_synchronize();
+  } while ((seq & 1) || seq != husage->seq);
+
+  return SIM_OK;
+}
+
+
+// SIM thread, the contexts keep their slots so counting goes on right away
+void SIM_Usage_Reset(SIM_Usage_HandlerTypeDef *husage)
+{
+  SIM_Usage_Context_t *ctx;
+
+  SIM_SEQ_WRITE_BEGIN(husage->seq);
+  for (uint8_t i = 0; i < SIM_NET_PDP_NUM; i++) {
+    ctx = &husage->contexts[i];
+    __atomic_store_n(&ctx->socket.txBytes, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&ctx->socket.rxBytes, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&ctx->http.txBytes, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&ctx->http.rxBytes, 0, __ATOMIC_RELAXED);
+    ctx->modem.txBytes = 0;
+    ctx->modem.rxBytes = 0;
+    ctx->modemTick = 0;
+  }
+  SIM_SEQ_WRITE_END(husage->seq);
+}
+
+
+// slots are claimed in order, so two threads claiming one cid meet at the same slot
+static SIM_Usage_Context_t* getContext(SIM_Usage_HandlerTypeDef *husage, uint8_t cid)
+{
+  uint8_t slotCid;
+
+  if (cid == 0) cid = SIM_NET_DEFAULT_CID;
+  for (uint8_t i = 0; i < SIM_NET_PDP_NUM; i++) {
+    slotCid = __atomic_load_n(&husage->contexts[i].cid, __ATOMIC_ACQUIRE);
+    if (slotCid == 0 &&
+        __atomic_compare_exchange_n(&husage->contexts[i].cid, &slotCid, cid,
+                                    0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      return &husage->contexts[i];
+    }
+    if (slotCid == cid) return &husage->contexts[i];
+  }
+  return 0;
+}
+
+#endif /* SIM_EN_FEATURE_USAGE */
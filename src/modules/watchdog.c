@@ -0,0 +1,296 @@
+/*
+ * watchdog.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ */
+
+#include "../include/simcom/watchdog.h"
+#if SIM_EN_FEATURE_WATCHDOG
+
+#include "../include/simcom.h"
+#include "../include/simcom/utils.h"
+#include "../events.h"
+#include <string.h>
+
+#define SIM_WDG_FLAG_SUSPECT    0x01  // a command timed out
+#define SIM_WDG_FLAG_READY      0x02  // "RDY" after a reset of the watchdog
+#define SIM_WDG_FLAG_RESTARTED  0x04  // "RDY" nobody asked for
+
+static void setStage(SIM_WDG_HandlerTypeDef*, uint8_t newStage, uint8_t cause);
+static void resetModem(SIM_WDG_HandlerTypeDef*, uint8_t hard);
+static void dropSessions(SIM_WDG_HandlerTypeDef*);
+static void restore(SIM_WDG_HandlerTypeDef*);
+static void finish(SIM_WDG_HandlerTypeDef*);
+static AT_Status_t shortCommand(SIM_WDG_HandlerTypeDef*, const char *cmd);
+
+
+SIM_Status_t SIM_WDG_Init(SIM_WDG_HandlerTypeDef *hwdg, void *hsim)
+{
+  if (((SIM_HandlerTypeDef*)hsim)->key != SIM_KEY)
+    return SIM_ERROR;
+
+  hwdg->hsim = hsim;
+  hwdg->stage = SIM_WDG_STAGE_IDLE;
+  hwdg->timeouts = 0;
+  hwdg->flags = 0;
+  hwdg->isRestored = 0;
+  hwdg->restoreMask = 0;
+  hwdg->detectTick = 0;
+  hwdg->stageTick = 0;
+  memset(&hwdg->stats, 0, sizeof(SIM_WDG_Stats_t));
+
+  return SIM_OK;
+}
+
+
+// AT hook, called from any thread after every library command
+void SIM_WDG_OnResult(SIM_WDG_HandlerTypeDef *hwdg, AT_Status_t result)
+{
+  SIM_HandlerTypeDef *hsim = hwdg->hsim;
+  uint8_t stage = hwdg->stage;
+
+  if (stage != SIM_WDG_STAGE_IDLE && stage != SIM_WDG_STAGE_RESTORING) return;
+  if (result != AT_TIMEOUT) {
+    hwdg->timeouts = 0;
+    return;
+  }
+  // timeouts are expected while the modem boots
+  if (hsim->state <= SIM_STATE_CHECK_AT) return;
+
+  if (__atomic_add_fetch(&hwdg->timeouts, 1, __ATOMIC_RELAXED) < SIM_WDG_MAX_TIMEOUTS) {
+    __atomic_fetch_or(&hwdg->flags, SIM_WDG_FLAG_SUSPECT, __ATOMIC_RELEASE);
+  }
+  else if (__atomic_compare_exchange_n(&hwdg->stage, &stage, SIM_WDG_STAGE_DETECTED,
+                                       0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+  {
+    SIM_TRACE(hsim, SIM_TRACE_MOD_WATCHDOG, stage, SIM_WDG_STAGE_DETECTED,
+              SIM_TRACE_CAUSE_TIMEOUT);
+    if (stage == SIM_WDG_STAGE_IDLE)
+      hwdg->detectTick = hsim->getTick();
+  }
+  else return;
+
+  SIM_EventSet(hsim, SIM_RTOS_EVT_WDG);
+}
+
+
+// AT handler thread, on "RDY" before the core restarts its state machine
+void SIM_WDG_OnReady(SIM_WDG_HandlerTypeDef *hwdg)
+{
+  SIM_HandlerTypeDef *hsim = hwdg->hsim;
+  uint8_t stage = hwdg->stage;
+
+  if (stage == SIM_WDG_STAGE_SOFT_RESET || stage == SIM_WDG_STAGE_HARD_RESET) {
+    __atomic_fetch_or(&hwdg->flags, SIM_WDG_FLAG_READY, __ATOMIC_RELEASE);
+  }
+  else if (stage == SIM_WDG_STAGE_RESTORING || hsim->state >= SIM_STATE_CHECK_NETWORK) {
+    __atomic_fetch_or(&hwdg->flags, SIM_WDG_FLAG_RESTARTED, __ATOMIC_RELEASE);
+  }
+  else return;
+
+  SIM_EventSet(hsim, SIM_RTOS_EVT_WDG);
+}
+
+
+void SIM_WDG_OnEvent(SIM_WDG_HandlerTypeDef *hwdg)
+{
+  SIM_HandlerTypeDef *hsim = hwdg->hsim;
+  uint8_t flags = __atomic_exchange_n(&hwdg->flags, 0, __ATOMIC_ACQUIRE);
+
+  if (flags & SIM_WDG_FLAG_RESTARTED) {
+    // the modem restarted on its own, its sessions are gone
+    if (hwdg->stage == SIM_WDG_STAGE_IDLE) {
+      hwdg->detectTick = hsim->getTick();
+      hwdg->stats.detections++;
+    }
+    dropSessions(hwdg);
+    setStage(hwdg, SIM_WDG_STAGE_RESTORING, SIM_TRACE_CAUSE_RESET);
+  }
+
+  if ((flags & SIM_WDG_FLAG_READY)
+      && (hwdg->stage == SIM_WDG_STAGE_SOFT_RESET || hwdg->stage == SIM_WDG_STAGE_HARD_RESET))
+  {
+    setStage(hwdg, SIM_WDG_STAGE_RESTORING, SIM_TRACE_CAUSE_RESET);
+  }
+
+  if (flags & SIM_WDG_FLAG_SUSPECT) {
+    // confirms the stuck channel with short probes instead of waiting for
+    // the next commands to time out
+    for (uint8_t i = 0; i < SIM_WDG_MAX_TIMEOUTS; i++) {
+      if (hwdg->timeouts == 0 || hwdg->stage == SIM_WDG_STAGE_DETECTED) break;
+      shortCommand(hwdg, "E0");
+    }
+  }
+
+  if (hwdg->stage == SIM_WDG_STAGE_DETECTED) {
+    hwdg->stats.detections++;
+    resetModem(hwdg, 0);
+  }
+}
+
+
+// SIM thread, runs before the other loops
+void SIM_WDG_Loop(SIM_WDG_HandlerTypeDef *hwdg)
+{
+  SIM_HandlerTypeDef *hsim = hwdg->hsim;
+
+  switch (hwdg->stage) {
+  case SIM_WDG_STAGE_SOFT_RESET:
+  case SIM_WDG_STAGE_HARD_RESET:
+    if (SIM_CheckTimeout(hsim, hwdg->stageTick,
+                         (hwdg->stage == SIM_WDG_STAGE_SOFT_RESET)?
+                             SIM_WDG_SOFT_TIMEOUT: SIM_WDG_HARD_TIMEOUT))
+    {
+      // a modem with the "RDY" report disabled only answers
+      if (shortCommand(hwdg, "E0") == AT_OK) {
+        setStage(hwdg, SIM_WDG_STAGE_RESTORING, SIM_TRACE_CAUSE_OK);
+      } else {
+        resetModem(hwdg, 1);
+      }
+    }
+    break;
+
+  case SIM_WDG_STAGE_RESTORING:
+    restore(hwdg);
+    break;
+
+  default: break;
+  }
+}
+
+
+// the other state machines are held while the modem restarts
+uint8_t SIM_WDG_IsResetting(SIM_WDG_HandlerTypeDef *hwdg)
+{
+  uint8_t stage = hwdg->stage;
+
+  return stage == SIM_WDG_STAGE_DETECTED
+      || stage == SIM_WDG_STAGE_SOFT_RESET
+      || stage == SIM_WDG_STAGE_HARD_RESET;
+}
+
+
+void SIM_WDG_GetStats(SIM_WDG_HandlerTypeDef *hwdg, SIM_WDG_Stats_t *stats)
+{
+  memcpy(stats, &hwdg->stats, sizeof(SIM_WDG_Stats_t));
+}
+
+
+static void setStage(SIM_WDG_HandlerTypeDef *hwdg, uint8_t newStage, uint8_t cause)
+{
+  SIM_HandlerTypeDef *hsim = hwdg->hsim;
+
+  SIM_TRACE(hsim, SIM_TRACE_MOD_WATCHDOG, hwdg->stage, newStage, cause);
+  hwdg->stageTick = hsim->getTick();
+  hwdg->stage = newStage;
+}
+
+
+// soft reset first, then the hardReset hook until the modem comes back
+static void resetModem(SIM_WDG_HandlerTypeDef *hwdg, uint8_t hard)
+{
+  SIM_HandlerTypeDef *hsim = hwdg->hsim;
+
+  __atomic_fetch_and(&hwdg->flags, ~SIM_WDG_FLAG_READY, __ATOMIC_RELAXED);
+  hwdg->timeouts = 0;
+  dropSessions(hwdg);
+
+  if (hard && hwdg->hardReset) {
+    hwdg->stats.hardResets++;
+    setStage(hwdg, SIM_WDG_STAGE_HARD_RESET, SIM_TRACE_CAUSE_TIMEOUT);
+    hwdg->hardReset();
+  } else {
+    hwdg->stats.softResets++;
+    setStage(hwdg, SIM_WDG_STAGE_SOFT_RESET, SIM_TRACE_CAUSE_TIMEOUT);
+    // usually unanswered on a stuck channel
+    shortCommand(hwdg, "+CFUN=1,1");
+  }
+
+  SIM_SetState(hsim, SIM_STATE_CHECK_AT);
+}
+
+
+// marks what the restart takes down, restore() brings it back in one pass
+static void dropSessions(SIM_WDG_HandlerTypeDef *hwdg)
+{
+#if SIM_EN_FEATURE_NET
+  SIM_HandlerTypeDef *hsim = hwdg->hsim;
+#endif
+
+  hwdg->isRestored = 0;
+#if SIM_EN_FEATURE_NET
+  SIM_NET_SetState(&hsim->net, SIM_NET_STATE_NON_ACTIVE);
+#endif
+#if SIM_EN_FEATURE_SOCKET
+  hwdg->restoreMask |= SIM_SockManager_OnModemReset(&hsim->socketManager);
+#endif
+}
+
+
+static void restore(SIM_WDG_HandlerTypeDef *hwdg)
+{
+  SIM_HandlerTypeDef *hsim = hwdg->hsim;
+
+  if (SIM_CheckTimeout(hsim, hwdg->stageTick, SIM_WDG_RESTORE_TIMEOUT)) {
+    // no network, the sockets keep reconnecting on their own
+    hwdg->restoreMask = 0;
+    setStage(hwdg, SIM_WDG_STAGE_IDLE, SIM_TRACE_CAUSE_TIMEOUT);
+    return;
+  }
+
+#if SIM_EN_FEATURE_NET
+  if (hsim->net.state != SIM_NET_STATE_ONLINE) return;
+#else
+  if (hsim->state != SIM_STATE_ACTIVE) return;
+#endif
+
+#if SIM_EN_FEATURE_SOCKET
+  if (hwdg->restoreMask != 0) {
+    // one NETOPEN, the manager reopens every waiting socket when it is up
+    if (!hwdg->isRestored) {
+      hwdg->isRestored = 1;
+      SIM_SockManager_NetOpen(&hsim->socketManager);
+    }
+
+    for (uint8_t i = 0; i < SIM_NUM_OF_SOCKET; i++) {
+      SIM_SocketClient_t *sock = hsim->socketManager.sockets[i];
+
+      if ((hwdg->restoreMask & (1UL << i)) == 0) continue;
+      if (sock == 0 || sock->state == SIM_SOCK_CLIENT_STATE_OPEN)
+        hwdg->restoreMask &= ~(1UL << i);
+    }
+    if (hwdg->restoreMask != 0) return;
+  }
+#endif
+
+  finish(hwdg);
+}
+
+
+static void finish(SIM_WDG_HandlerTypeDef *hwdg)
+{
+  SIM_HandlerTypeDef *hsim = hwdg->hsim;
+  uint32_t recoverTime = hsim->getTick() - hwdg->detectTick;
+
+  hwdg->stats.recoveries++;
+  hwdg->stats.lastRecoverTime = recoverTime;
+  if (recoverTime > hwdg->stats.maxRecoverTime)
+    hwdg->stats.maxRecoverTime = recoverTime;
+
+  hwdg->timeouts = 0;
+  setStage(hwdg, SIM_WDG_STAGE_IDLE, SIM_TRACE_CAUSE_OK);
+
+  if (hwdg->onRecovered) hwdg->onRecovered(recoverTime);
+}
+
+
+// commands of other threads wait, they keep their own timeout
+static AT_Status_t shortCommand(SIM_WDG_HandlerTypeDef *hwdg, const char *cmd)
+{
+  SIM_HandlerTypeDef *hsim = hwdg->hsim;
+
+  return SIM_AT_CommandTimeout(&hsim->atCmd, cmd, SIM_WDG_PROBE_TIMEOUT);
+}
+
+#endif /* SIM_EN_FEATURE_WATCHDOG */
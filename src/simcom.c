@@ -12,10 +12,28 @@
 #include <stdlib.h>
 
 #define IS_EVENT(evt_notif, evt_wait) SIM_BITS_IS(evt_notif, evt_wait)
+#define BOOT_PHASE(hsim, phase) {\
+  if ((hsim)->bootTiming.phase == 0)\
+    (hsim)->bootTiming.phase = (hsim)->getTick() - (hsim)->tick.init;\
+}
 
+static void setState(SIM_HandlerTypeDef*, uint8_t newState, uint8_t cause);
 static void onNewState(SIM_HandlerTypeDef*);
 static void loop(SIM_HandlerTypeDef*);
+static void runLoops(SIM_HandlerTypeDef*);
+static void handleEvents(SIM_HandlerTypeDef*, uint32_t notifEvent);
+static uint32_t getTimeout(SIM_HandlerTypeDef*);
 static void onReady(void *app, AT_Data_t*);
+#if SIM_EN_URC_SIMCARD
+static void onSIMCard(void *app, AT_Data_t*);
+#endif
+#if SIM_EN_URC_REGISTRATION
+static void onNetworkRegistration(void *app, AT_Data_t*);
+#endif
+#if SIM_EN_URC_SIGNAL
+static void onSignalQuality(void *app, AT_Data_t*);
+static void onSystemInfo(void *app, AT_Data_t*);
+#endif
 
 
 SIM_Status_t SIM_Init(SIM_HandlerTypeDef *hsim)
@@ -25,6 +43,7 @@ SIM_Status_t SIM_Init(SIM_HandlerTypeDef *hsim)
 
   hsim->atCmd.serial.readline = hsim->serial.readline;
   hsim->network_status = 0;
+  hsim->simcard = SIM_CARD_UNKNOWN;
 
   hsim->atCmd.serial.read     = hsim->serial.read;
   hsim->atCmd.serial.readinto = hsim->serial.readinto;
@@ -40,10 +59,53 @@ SIM_Status_t SIM_Init(SIM_HandlerTypeDef *hsim)
   AT_Config_t config;
   config.timeout = 30000; // ms
 
+#if SIM_EN_STATIC_ALLOC
+  hsim->memPoolUsed = 0;
+#endif
+
+#if SIM_EN_FEATURE_TRACE
+  SIM_Trace_Init(&hsim->trace);
+#endif
+
   if (AT_Init(&hsim->atCmd, &config) != AT_OK) return SIM_ERROR;
 
   AT_On(&hsim->atCmd, "RDY", hsim, 0, 0, onReady);
 
+#if SIM_EN_URC_SIMCARD
+  AT_Data_t *cpinResp = SIM_Malloc(hsim, sizeof(AT_Data_t));
+  AT_DataSetBuffer(cpinResp, SIM_Malloc(hsim, 16), 16);
+  AT_On(&hsim->atCmd, "+CPIN", hsim, 1, cpinResp, onSIMCard);
+
+  AT_Data_t *hotswapResp = SIM_Malloc(hsim, sizeof(AT_Data_t));
+  AT_DataSetBuffer(hotswapResp, SIM_Malloc(hsim, 16), 16);
+  AT_On(&hsim->atCmd, "+SIMCARD", hsim, 1, hotswapResp, onSIMCard);
+#endif /* SIM_EN_URC_SIMCARD */
+
+#if SIM_EN_URC_REGISTRATION
+  AT_On(&hsim->atCmd, "+CREG", hsim, 4, SIM_NewRegistrationResp(hsim), onNetworkRegistration);
+#endif /* SIM_EN_URC_REGISTRATION */
+
+#if SIM_EN_URC_SIGNAL
+  AT_Data_t *csqResp = SIM_Malloc(hsim, sizeof(AT_Data_t)*2);
+  AT_DataSetNumber(csqResp, 99);
+  AT_DataSetNumber(csqResp+1, 99);
+  AT_On(&hsim->atCmd, "+CSQ", hsim, 2, csqResp, onSignalQuality);
+
+  // +CPSI: <mode>,<op mode>,<mcc-mnc>,<tac>,<cell id>,<pcid>,<band>,
+  //        <earfcn>,<dlbw>,<ulbw>,<rsrq>,<rsrp>,<rssi>,<rssnr>
+  AT_Data_t *cpsiResp = SIM_Malloc(hsim, sizeof(AT_Data_t)*14);
+  uint8_t *cpsiRespStr = SIM_Malloc(hsim, 8*4 + 16);
+  AT_DataSetBuffer(cpsiResp, cpsiRespStr, 8);
+  AT_DataSetBuffer(cpsiResp+1, cpsiRespStr+8, 8);
+  AT_DataSetBuffer(cpsiResp+2, cpsiRespStr+16, 8);
+  AT_DataSetBuffer(cpsiResp+3, cpsiRespStr+24, 8);
+  for (uint8_t i = 4; i < 14; i++) {
+    AT_DataSetNumber(cpsiResp+i, 0);
+  }
+  AT_DataSetBuffer(cpsiResp+6, cpsiRespStr+32, 16);
+  AT_On(&hsim->atCmd, "+CPSI", hsim, 14, cpsiResp, onSystemInfo);
+#endif /* SIM_EN_URC_SIGNAL */
+
   hsim->key = SIM_KEY;
 
 #if SIM_EN_FEATURE_NET
@@ -71,7 +133,54 @@ SIM_Status_t SIM_Init(SIM_HandlerTypeDef *hsim)
   SIM_FILE_Init(&hsim->file, hsim);
 #endif /* SIM_EN_FEATURE_GPS */
 
+#if SIM_EN_FEATURE_STATS
+  SIM_Stats_Init(&hsim->stats, hsim);
+#endif /* SIM_EN_FEATURE_STATS */
+
+#if SIM_EN_FEATURE_ATQUEUE
+  SIM_ATQ_Init(&hsim->atq, hsim);
+#endif /* SIM_EN_FEATURE_ATQUEUE */
+
+#if SIM_EN_FEATURE_POWER
+  SIM_PWR_Init(&hsim->power, hsim);
+#endif /* SIM_EN_FEATURE_POWER */
+
+#if SIM_EN_FEATURE_WATCHDOG
+  SIM_WDG_Init(&hsim->watchdog, hsim);
+#endif /* SIM_EN_FEATURE_WATCHDOG */
+
+#if SIM_EN_FEATURE_CLOCK
+  SIM_Clock_Init(&hsim->clock, hsim);
+#endif /* SIM_EN_FEATURE_CLOCK */
+
+#if SIM_EN_FEATURE_USAGE
+  SIM_Usage_Init(&hsim->usage, hsim);
+#endif /* SIM_EN_FEATURE_USAGE */
+
+  memset(&hsim->bootTiming, 0, sizeof(SIM_BootTiming_t));
+  hsim->probeInterval = SIM_BOOT_PROBE_MIN;
+
+  memset(&hsim->cell, 0, sizeof(SIM_CellInfo_t));
+  hsim->cellSeq = 0;
+
+  memset(&hsim->reg.last, 0, sizeof(SIM_Operator_t));
+  memset(hsim->reg.stats, 0, sizeof(hsim->reg.stats));
+  hsim->reg.strategy = SIM_REG_STRATEGY_AUTO;
+  hsim->reg.isPending = 0;
+  hsim->reg.pref.mode = SIM_RADIO_KEEP;
+  hsim->reg.pref.order = SIM_RADIO_KEEP;
+  hsim->reg.pref.bands = 0;
+  hsim->reg.pref.lteBands = 0;
+
+  hsim->group = 0;
+  hsim->pendingEvents = 0;
+#if SIM_EN_AT_HOOK
+  hsim->atExclusive = 0;
+  hsim->atInFlight = 0;
+#endif
+
   hsim->tick.init = hsim->getTick();
+  hsim->tick.nextDeadline = hsim->tick.init;
 
   return SIM_OK;
 }
@@ -80,76 +189,73 @@ SIM_Status_t SIM_Init(SIM_HandlerTypeDef *hsim)
 void SIM_Thread_Run(SIM_HandlerTypeDef *hsim)
 {
   uint32_t notifEvent;
-  uint32_t timeout = 2000; // ms
-  uint32_t lastTO = 0;
+  uint32_t timeout;
 
   for (;;) {
+    // sleep until the earliest registered deadline or until an event comes
+    timeout = getTimeout(hsim);
+
     if (hsim->rtos.eventWait(SIM_RTOS_AVT_ALL, &notifEvent, timeout) == AT_OK) {
-      if (IS_EVENT(notifEvent, SIM_RTOS_EVT_READY)) {
+      handleEvents(hsim, notifEvent);
+    }
 
-      }
-      if (IS_EVENT(notifEvent, SIM_RTOS_EVT_NEW_STATE)) {
-        onNewState(hsim);
-      }
-      if (IS_EVENT(notifEvent, SIM_RTOS_EVT_ACTIVED)) {
-#if SIM_EN_FEATURE_NET
-        SIM_NET_SetState(&hsim->net, SIM_NET_STATE_CHECK_GPRS);
-#endif /* SIM_EN_FEATURE_NET */
+    // state handlers may have moved the deadlines, so every pass
+    // re-collects them from the loops
+    runLoops(hsim);
+  }
+}
 
-#if SIM_EN_FEATURE_GPS
-        SIM_GPS_SetState(&hsim->gps, SIM_GPS_STATE_SETUP);
-#endif /* SIM_EN_FEATURE_GPS */
-      }
 
-#if SIM_EN_FEATURE_NET
-      if (IS_EVENT(notifEvent, SIM_RTOS_EVT_NET_NEW_STATE)) {
-        SIM_NET_OnNewState(&hsim->net);
-      }
-#endif /* SIM_EN_FEATURE_NET */
+// One thread serving every instance of the group
+void SIM_Thread_RunGroup(SIM_Group_t *group)
+{
+  SIM_HandlerTypeDef *hsim;
+  uint32_t notifEvent;
+  uint32_t events;
+  uint32_t timeout;
+  uint8_t  first = 0;
+  uint8_t  idx;
 
-#if SIM_EN_FEATURE_SOCKET
-      if (IS_EVENT(notifEvent, SIM_RTOS_EVT_SOCKMGR_NEW_STATE)) {
-        SIM_SockManager_OnNewState(&hsim->socketManager);
-      }
-      if (IS_EVENT(notifEvent, SIM_RTOS_EVT_SOCKCLIENT_NEW_EVT)) {
-        SIM_SockManager_CheckSocketsEvents(&hsim->socketManager);
-      }
-#endif /* SIM_EN_FEATURE_SOCKET */
+  for (;;) {
+    timeout = SIM_SCHED_MAX_IDLE;
+    for (uint8_t i = 0; i < group->instancesNb; i++) {
+      if (getTimeout(group->instances[i]) < timeout)
+        timeout = getTimeout(group->instances[i]);
+    }
 
-#if SIM_EN_FEATURE_NTP
-      if (IS_EVENT(notifEvent, SIM_RTOS_EVT_NTP_SYNCED)) {
-        SIM_NTP_OnSynced(&hsim->ntp);
-      }
-#endif /* SIM_EN_FEATURE_NTP */
+    group->eventWait(group->context, SIM_GROUP_EVT_WAKEUP, &notifEvent, timeout);
 
-#if SIM_EN_FEATURE_GPS
-      if (IS_EVENT(notifEvent, SIM_RTOS_EVT_GPS_NEW_STATE)) {
-        SIM_GPS_OnNewState(&hsim->gps);
-      }
-#endif /* SIM_EN_FEATURE_GPS */
+    // rotate the first instance so a busy modem can't starve the others
+    for (uint8_t i = 0; i < group->instancesNb; i++) {
+      idx = (first + i) % group->instancesNb;
+      hsim = group->instances[idx];
 
-      goto next;
+      events = __atomic_exchange_n(&hsim->pendingEvents, 0, __ATOMIC_ACQUIRE);
+      if (events) {
+        handleEvents(hsim, events);
+      }
+      if (events || getTimeout(hsim) == 0) {
+        runLoops(hsim);
+      }
     }
+    if (group->instancesNb > 0) {
+      first = (first + 1) % group->instancesNb;
+    }
+  }
+}
 
-    lastTO = hsim->getTick();
-    loop(hsim);
 
-#if SIM_EN_FEATURE_NET
-    SIM_NET_Loop(&hsim->net);
-#endif /* SIM_EN_FEATURE_NET */
-
-#if SIM_EN_FEATURE_SOCKET
-    SIM_SockManager_Loop(&hsim->socketManager);
-#endif /* SIM_EN_FEATURE_SOCKET */
+SIM_Status_t SIM_Group_Add(SIM_Group_t *group, SIM_HandlerTypeDef *hsim)
+{
+  if (hsim->key != SIM_KEY) return SIM_ERROR;
+  if (group->instancesNb >= SIM_GROUP_MAX_INSTANCES) return SIM_ERROR;
+  if (group->eventSet == 0 || group->eventWait == 0) return SIM_ERROR;
 
-#if SIM_EN_FEATURE_NTP
-    SIM_NTP_Loop(&hsim->ntp);
-#endif /* SIM_EN_FEATURE_NTP */
+  hsim->pendingEvents = 0;
+  hsim->group = group;
+  group->instances[group->instancesNb++] = hsim;
 
-  next:
-    timeout = 1000 - (hsim->getTick() - lastTO);
-    if (timeout > 1000) timeout = 1;
-  }
+  return SIM_OK;
 }
 
 
@@ -157,12 +263,55 @@ void SIM_Thread_Run(SIM_HandlerTypeDef *hsim)
 void SIM_Thread_ATCHandler(SIM_HandlerTypeDef *hsim)
 {
   AT_Process(&hsim->atCmd);
+#if SIM_EN_FEATURE_SOCKET
+  SIM_SockManager_OnATProcessed(&hsim->socketManager);
+#endif
+}
+
+uint8_t SIM_CheckTimeout(SIM_HandlerTypeDef *hsim, uint32_t lastTick, uint32_t timeout)
+{
+  uint32_t deadline;
+  uint8_t  isTimeout = SIM_IsTimeout(hsim, lastTick, timeout);
+
+  // SIM_IsTimeout is exclusive, it fires one tick after lastTick + timeout.
+  // A fired timer is usually restarted from now by the caller, it stays armed
+  // for that period so the thread does not sleep through it.
+  if (isTimeout) {
+    if (timeout == 0) return 1;
+    deadline = hsim->getTick() + timeout + 1;
+  } else {
+    deadline = lastTick + timeout + 1;
+  }
+  if ((int32_t)(deadline - hsim->tick.nextDeadline) < 0) {
+    hsim->tick.nextDeadline = deadline;
+  }
+  return isTimeout;
+}
+
+// Notifies the thread running this instance
+void SIM_EventSet(SIM_HandlerTypeDef *hsim, uint32_t events)
+{
+  SIM_Group_t *group = hsim->group;
+
+  if (group == 0) {
+    hsim->rtos.eventSet(events);
+    return;
+  }
+
+  __atomic_fetch_or(&hsim->pendingEvents, events, __ATOMIC_RELEASE);
+  group->eventSet(group->context, SIM_GROUP_EVT_WAKEUP);
 }
 
 void SIM_SetState(SIM_HandlerTypeDef *hsim, uint8_t newState)
 {
+  setState(hsim, newState, SIM_TRACE_CAUSE_NONE);
+}
+
+static void setState(SIM_HandlerTypeDef *hsim, uint8_t newState, uint8_t cause)
+{
+  SIM_TRACE(hsim, SIM_TRACE_MOD_CORE, hsim->state, newState, cause);
   hsim->state = newState;
-  hsim->rtos.eventSet(SIM_RTOS_EVT_NEW_STATE);
+  SIM_EventSet(hsim, SIM_RTOS_EVT_NEW_STATE);
 }
 
 static void onNewState(SIM_HandlerTypeDef *hsim)
@@ -172,29 +321,55 @@ static void onNewState(SIM_HandlerTypeDef *hsim)
   switch (hsim->state) {
   case SIM_STATE_NON_ACTIVE:
   case SIM_STATE_CHECK_AT:
-    if (SIM_CheckAT(hsim) == SIM_OK) {
-      SIM_SetState(hsim, SIM_STATE_CHECK_SIMCARD);
+    if (SIM_ProbeAT(hsim, SIM_BOOT_PROBE_TIMEOUT) == SIM_OK) {
+      hsim->probeInterval = SIM_BOOT_PROBE_MIN;
+      setState(hsim, SIM_STATE_CHECK_SIMCARD, SIM_TRACE_CAUSE_OK);
+    }
+    else if (hsim->probeInterval < SIM_BOOT_PROBE_MAX) {
+      hsim->probeInterval *= 2;
+      if (hsim->probeInterval > SIM_BOOT_PROBE_MAX)
+        hsim->probeInterval = SIM_BOOT_PROBE_MAX;
     }
     break;
 
   case SIM_STATE_CHECK_SIMCARD:
+    BOOT_PHASE(hsim, atReady);
+#if SIM_EN_URC_SIMCARD && SIM_SIMCARD_HOTSWAP
+    if (!SIM_IS_STATUS(hsim, SIM_STATUS_HOTSWAP_ON)) {
+      SIM_SetSIMCardHotSwap(hsim, 1);
+    }
+#endif /* SIM_EN_URC_SIMCARD && SIM_SIMCARD_HOTSWAP */
     SIM_Debug("Checking SIM Card....");
     if (SIM_CheckSIMCard(hsim) == SIM_OK) {
-      SIM_SetState(hsim, SIM_STATE_CHECK_NETWORK);
+      setState(hsim, SIM_STATE_CHECK_NETWORK, SIM_TRACE_CAUSE_OK);
       SIM_Debug("SIM card OK");
     } else {
-      SIM_Debug("SIM card Not Ready");
+      SIM_Debug("SIM card Not Ready (%u)", hsim->simcard);
       break;
     }
     break;
 
   case SIM_STATE_CHECK_NETWORK:
+    BOOT_PHASE(hsim, simReady);
+#if SIM_EN_URC_REGISTRATION
+    if (!SIM_IS_STATUS(hsim, SIM_STATUS_REG_URC_ON)) {
+      SIM_SetRegistrationURC(hsim, 2);
+    }
+#endif /* SIM_EN_URC_REGISTRATION */
     SIM_Debug("Checking cellular network....");
     if (SIM_CheckNetwork(hsim) == SIM_OK) {
       SIM_Debug("Cellular network registered", (hsim->network_status == 5)? " (roaming)":"");
-      hsim->rtos.eventSet(SIM_RTOS_EVT_NEW_STATE);
+      SIM_EventSet(hsim, SIM_RTOS_EVT_NEW_STATE);
+    }
+    else if (hsim->bootTiming.registered == 0 && !hsim->reg.isPending) {
+      SIM_ApplyRadioPreference(hsim);
+      SIM_SelectOperator(hsim);
     }
-    else if (hsim->network_status == 0) {
+    // +COPS=4 falls back to automatic selection by itself, forcing +COPS=0
+    // would cancel the attempt on the last operator before it timed out
+    else if (hsim->network_status == 0 &&
+             !(hsim->reg.isPending && hsim->reg.strategy == SIM_REG_STRATEGY_LAST_OPERATOR))
+    {
       SIM_ReqisterNetwork(hsim);
     }
     else if (hsim->network_status == 2) {
@@ -204,7 +379,14 @@ static void onNewState(SIM_HandlerTypeDef *hsim)
     break;
 
   case SIM_STATE_ACTIVE:
-    hsim->rtos.eventSet(SIM_RTOS_EVT_ACTIVED);
+    BOOT_PHASE(hsim, registered);
+    SIM_OnRegistered(hsim);
+#if SIM_EN_URC_SIGNAL
+    if (!SIM_IS_STATUS(hsim, SIM_STATUS_SIGNAL_URC_ON)) {
+      SIM_SetSignalURC(hsim, 1);
+    }
+#endif /* SIM_EN_URC_SIGNAL */
+    SIM_EventSet(hsim, SIM_RTOS_EVT_ACTIVED);
     break;
 
   default: break;
@@ -215,40 +397,201 @@ static void loop(SIM_HandlerTypeDef* hsim)
 {
   switch (hsim->state) {
   case SIM_STATE_NON_ACTIVE:
-    if (SIM_IsTimeout(hsim, hsim->tick.init, 30000)) {
-      SIM_SetState(hsim, SIM_STATE_CHECK_AT);
-    }
+    // don't wait for "RDY", the modem may be up already after an MCU reset
+    setState(hsim, SIM_STATE_CHECK_AT, SIM_TRACE_CAUSE_NONE);
     break;
 
   case SIM_STATE_CHECK_AT:
-    if (SIM_IsTimeout(hsim, hsim->tick.changedState, 1000)) {
-      SIM_SetState(hsim, SIM_STATE_CHECK_SIMCARD);
+    if (SIM_CheckTimeout(hsim, hsim->tick.changedState, hsim->probeInterval)) {
+      setState(hsim, SIM_STATE_CHECK_AT, SIM_TRACE_CAUSE_TIMEOUT);
     }
     break;
 
   case SIM_STATE_CHECK_SIMCARD:
-    if (SIM_IsTimeout(hsim, hsim->tick.changedState, 2000)) {
-      SIM_SetState(hsim, SIM_STATE_CHECK_SIMCARD);
+#if SIM_EN_URC_SIMCARD
+    // +CPIN URC moves the state, this is only the slow fallback
+    if (SIM_CheckTimeout(hsim, hsim->tick.changedState, SIM_SIMCARD_FALLBACK_INTERVAL)) {
+#else
+    if (SIM_CheckTimeout(hsim, hsim->tick.changedState, 2000)) {
+#endif
+      setState(hsim, SIM_STATE_CHECK_SIMCARD, SIM_TRACE_CAUSE_TIMEOUT);
     }
     break;
 
   case SIM_STATE_CHECK_NETWORK:
-    if (SIM_IsTimeout(hsim, hsim->tick.changedState, 3000)) {
-      SIM_SetState(hsim, SIM_STATE_CHECK_NETWORK);
+    if (hsim->reg.isPending && hsim->reg.strategy == SIM_REG_STRATEGY_LAST_OPERATOR &&
+        SIM_CheckTimeout(hsim, hsim->reg.startTick, SIM_REG_LAST_OPERATOR_TIMEOUT))
+    {
+      // the registration is timed as an automatic one from here
+      hsim->reg.strategy = SIM_REG_STRATEGY_AUTO;
+      hsim->reg.stats[SIM_REG_STRATEGY_AUTO].attempts++;
+      setState(hsim, SIM_STATE_CHECK_NETWORK, SIM_TRACE_CAUSE_TIMEOUT);
+      break;
+    }
+#if SIM_EN_URC_REGISTRATION
+    // +CREG URC moves the state, this is only the slow fallback
+    if (SIM_CheckTimeout(hsim, hsim->tick.changedState, SIM_REG_FALLBACK_INTERVAL)) {
+#else
+    if (SIM_CheckTimeout(hsim, hsim->tick.changedState, 3000)) {
+#endif
+      setState(hsim, SIM_STATE_CHECK_NETWORK, SIM_TRACE_CAUSE_TIMEOUT);
     }
     break;
 
   case SIM_STATE_ACTIVE:
-    if (SIM_IsTimeout(hsim, hsim->tick.checksignal, 3000)) {
+#if SIM_EN_FEATURE_ATQUEUE
+    if (SIM_ATQ_IsDataFlowing(&hsim->atq)) break;
+#endif /* SIM_EN_FEATURE_ATQUEUE */
+#if !SIM_EN_URC_SIGNAL
+    if (SIM_CheckTimeout(hsim, hsim->tick.checksignal, 3000)) {
       hsim->tick.checksignal = hsim->getTick();
       SIM_CheckSugnal(hsim);
     }
+#endif /* !SIM_EN_URC_SIGNAL */
+#ifdef SIM_CELL_INFO_INTERVAL
+    if (SIM_CheckTimeout(hsim, hsim->tick.checkcell, SIM_CELL_INFO_INTERVAL)) {
+      hsim->tick.checkcell = hsim->getTick();
+      SIM_CheckSystemInfo(hsim);
+    }
+#endif /* SIM_CELL_INFO_INTERVAL */
     break;
 
   default: break;
   }
 }
 
+static void handleEvents(SIM_HandlerTypeDef *hsim, uint32_t notifEvent)
+{
+#if SIM_EN_FEATURE_POWER
+  // every event is a URC, a ring or a request, the modem has to be awake
+  SIM_PWR_OnEvent(&hsim->power);
+#endif /* SIM_EN_FEATURE_POWER */
+
+#if SIM_EN_FEATURE_WATCHDOG
+  if (IS_EVENT(notifEvent, SIM_RTOS_EVT_WDG)) {
+    SIM_WDG_OnEvent(&hsim->watchdog);
+  }
+#endif /* SIM_EN_FEATURE_WATCHDOG */
+
+  if (IS_EVENT(notifEvent, SIM_RTOS_EVT_READY)) {
+
+  }
+  if (IS_EVENT(notifEvent, SIM_RTOS_EVT_NEW_STATE)) {
+    onNewState(hsim);
+  }
+  if (IS_EVENT(notifEvent, SIM_RTOS_EVT_ACTIVED)) {
+#if SIM_EN_FEATURE_NET
+    SIM_NET_SetState(&hsim->net, SIM_NET_STATE_CHECK_GPRS);
+#endif /* SIM_EN_FEATURE_NET */
+
+#if SIM_EN_FEATURE_GPS
+    SIM_GPS_SetState(&hsim->gps, SIM_GPS_STATE_SETUP);
+#endif /* SIM_EN_FEATURE_GPS */
+  }
+
+#if SIM_EN_FEATURE_NET
+  if (IS_EVENT(notifEvent, SIM_RTOS_EVT_NET_NEW_STATE)) {
+    SIM_NET_OnNewState(&hsim->net);
+  }
+#endif /* SIM_EN_FEATURE_NET */
+
+#if SIM_EN_FEATURE_SOCKET
+  if (IS_EVENT(notifEvent, SIM_RTOS_EVT_SOCKMGR_NEW_STATE)) {
+    SIM_SockManager_OnNewState(&hsim->socketManager);
+  }
+  if (IS_EVENT(notifEvent, SIM_RTOS_EVT_SOCKCLIENT_NEW_EVT)) {
+    SIM_SockManager_CheckSocketsEvents(&hsim->socketManager);
+  }
+#endif /* SIM_EN_FEATURE_SOCKET */
+
+#if SIM_EN_FEATURE_NTP
+  if (IS_EVENT(notifEvent, SIM_RTOS_EVT_NTP_SYNCED)) {
+    SIM_NTP_OnSynced(&hsim->ntp);
+  }
+#endif /* SIM_EN_FEATURE_NTP */
+
+#if SIM_EN_FEATURE_HTTP
+  if (IS_EVENT(notifEvent, SIM_RTOS_EVT_HTTP_ASYNC)) {
+    SIM_HTTP_OnNewState(&hsim->http);
+  }
+#endif /* SIM_EN_FEATURE_HTTP */
+
+#if SIM_EN_FEATURE_GPS
+  if (IS_EVENT(notifEvent, SIM_RTOS_EVT_GPS_NEW_STATE)) {
+    SIM_GPS_OnNewState(&hsim->gps);
+  }
+#endif /* SIM_EN_FEATURE_GPS */
+
+#if SIM_EN_FEATURE_ATQUEUE
+  if (IS_EVENT(notifEvent, SIM_RTOS_EVT_ATQ_NEW_CMD)) {
+    SIM_ATQ_Process(&hsim->atq);
+  }
+#endif /* SIM_EN_FEATURE_ATQUEUE */
+}
+
+// ms left until the earliest deadline of the instance, 0 when it passed
+static uint32_t getTimeout(SIM_HandlerTypeDef *hsim)
+{
+  uint32_t timeout = hsim->tick.nextDeadline - hsim->getTick();
+
+  if (timeout > SIM_SCHED_MAX_IDLE) timeout = 0;
+  return timeout;
+}
+
+static void runLoops(SIM_HandlerTypeDef *hsim)
+{
+  hsim->tick.nextDeadline = hsim->getTick() + SIM_SCHED_MAX_IDLE;
+
+#if SIM_EN_FEATURE_POWER
+  // nothing polls a sleeping modem, the next event wakes it up
+  if (SIM_PWR_IsSleeping(&hsim->power)) return;
+#endif /* SIM_EN_FEATURE_POWER */
+
+#if SIM_EN_FEATURE_WATCHDOG
+  SIM_WDG_Loop(&hsim->watchdog);
+  // only the AT probing of the core runs while the modem restarts
+  if (SIM_WDG_IsResetting(&hsim->watchdog)) {
+    loop(hsim);
+    return;
+  }
+#endif /* SIM_EN_FEATURE_WATCHDOG */
+
+#if SIM_EN_FEATURE_ATQUEUE
+  // resumes housekeeping commands deferred by the data path
+  SIM_ATQ_Process(&hsim->atq);
+#endif /* SIM_EN_FEATURE_ATQUEUE */
+
+  loop(hsim);
+
+#if SIM_EN_FEATURE_NET
+  SIM_NET_Loop(&hsim->net);
+#endif /* SIM_EN_FEATURE_NET */
+
+#if SIM_EN_FEATURE_SOCKET
+  SIM_SockManager_Loop(&hsim->socketManager);
+#endif /* SIM_EN_FEATURE_SOCKET */
+
+#if SIM_EN_FEATURE_NTP
+  SIM_NTP_Loop(&hsim->ntp);
+#endif /* SIM_EN_FEATURE_NTP */
+
+#if SIM_EN_FEATURE_HTTP
+  SIM_HTTP_Loop(&hsim->http);
+#endif /* SIM_EN_FEATURE_HTTP */
+
+#if SIM_EN_FEATURE_CLOCK
+  SIM_Clock_Loop(&hsim->clock);
+#endif /* SIM_EN_FEATURE_CLOCK */
+
+#if SIM_EN_FEATURE_USAGE
+  SIM_Usage_Loop(&hsim->usage);
+#endif /* SIM_EN_FEATURE_USAGE */
+
+#if SIM_EN_FEATURE_POWER
+  SIM_PWR_Loop(&hsim->power);
+#endif /* SIM_EN_FEATURE_POWER */
+}
+
 static void onReady(void *app, AT_Data_t *_)
 {
   SIM_HandlerTypeDef *hsim = (SIM_HandlerTypeDef*)app;
@@ -257,5 +600,87 @@ static void onReady(void *app, AT_Data_t *_)
   hsim->events  = 0;
   SIM_Debug("Starting...");
 
-  SIM_SetState(hsim, SIM_STATE_CHECK_AT);
+#if SIM_EN_FEATURE_WATCHDOG
+  SIM_WDG_OnReady(&hsim->watchdog);
+#endif /* SIM_EN_FEATURE_WATCHDOG */
+
+  memset(&hsim->bootTiming, 0, sizeof(SIM_BootTiming_t));
+  hsim->probeInterval = SIM_BOOT_PROBE_MIN;
+  hsim->tick.init = hsim->getTick();
+  hsim->simcard = SIM_CARD_UNKNOWN;
+  // the operator is selected again once the SIM is ready
+  hsim->reg.isPending = 0;
+
+#if SIM_EN_FEATURE_POWER
+  // +CSCLK and the PSM/eDRX requests are lost with the restart
+  hsim->power.isApplied = 0;
+#endif /* SIM_EN_FEATURE_POWER */
+
+  setState(hsim, SIM_STATE_CHECK_AT, SIM_TRACE_CAUSE_RESET);
+}
+
+#if SIM_EN_URC_SIMCARD
+static void onSIMCard(void *app, AT_Data_t *resp)
+{
+  SIM_HandlerTypeDef *hsim = (SIM_HandlerTypeDef*)app;
+
+  SIM_UpdateSIMCard(hsim, SIM_ParseSIMCard(resp->value.string));
+  // URC storage is reused
+  resp->value.string[0] = 0;
+
+  if (hsim->simcard == SIM_CARD_READY) {
+    if (hsim->state == SIM_STATE_CHECK_SIMCARD)
+      setState(hsim, SIM_STATE_CHECK_NETWORK, SIM_TRACE_CAUSE_URC);
+  }
+  else if (hsim->simcard != SIM_CARD_UNKNOWN) {
+    if (hsim->state > SIM_STATE_CHECK_SIMCARD)
+      setState(hsim, SIM_STATE_CHECK_SIMCARD, SIM_TRACE_CAUSE_URC);
+  }
+}
+#endif /* SIM_EN_URC_SIMCARD */
+
+#if SIM_EN_URC_REGISTRATION
+static void onNetworkRegistration(void *app, AT_Data_t *resp)
+{
+  SIM_HandlerTypeDef *hsim = (SIM_HandlerTypeDef*)app;
+
+  hsim->network_status = (uint8_t) resp->value.number;
+  SIM_OnRegistrationCell(hsim, resp);
+
+  if (hsim->network_status == 1 || hsim->network_status == 5) {
+    if (hsim->network_status == 5) {
+      SIM_SET_STATUS(hsim, SIM_STATUS_ROAMING);
+    } else {
+      SIM_UNSET_STATUS(hsim, SIM_STATUS_ROAMING);
+    }
+
+    if (hsim->state == SIM_STATE_CHECK_NETWORK)
+      setState(hsim, SIM_STATE_ACTIVE, SIM_TRACE_CAUSE_URC);
+  }
+  else {
+    SIM_UNSET_STATUS(hsim, SIM_STATUS_ROAMING);
+    if (hsim->state > SIM_STATE_CHECK_NETWORK)
+      setState(hsim, SIM_STATE_CHECK_NETWORK, SIM_TRACE_CAUSE_URC);
+  }
+}
+#endif /* SIM_EN_URC_REGISTRATION */
+
+#if SIM_EN_URC_SIGNAL
+static void onSignalQuality(void *app, AT_Data_t *resp)
+{
+  SIM_HandlerTypeDef *hsim = (SIM_HandlerTypeDef*)app;
+
+  hsim->signal = (uint8_t) resp[1].value.number;
+
+  SIM_SEQ_WRITE_BEGIN(hsim->radioSeq);
+  hsim->radio.rssi = (uint8_t) resp[0].value.number;
+  hsim->radio.ber  = (uint8_t) resp[1].value.number;
+  hsim->radio.tick = hsim->getTick();
+  SIM_SEQ_WRITE_END(hsim->radioSeq);
+}
+
+static void onSystemInfo(void *app, AT_Data_t *resp)
+{
+  SIM_OnSystemInfo((SIM_HandlerTypeDef*)app, resp);
 }
+#endif /* SIM_EN_URC_SIGNAL */
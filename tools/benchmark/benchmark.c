@@ -0,0 +1,397 @@
+/*
+ * benchmark.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ *
+ * End-to-end benchmark of the socket, HTTP and GPS paths, results are printed
+ * as JSON. Build against the library and the at-command library with the
+ * features it measures, e.g.
+ *
+ *   cc -O2 -pthread -I<at-command>/include -I<lwgps>/include -DSIM_DEBUG=0 \
+ *      -DSIM_EN_FEATURE_SOCKET=1 -DSIM_EN_FEATURE_HTTP=1 \
+ *      -DSIM_EN_FEATURE_GPS=1 -DSIM_EN_FEATURE_STATS=1 \
+ *      benchmark.c ../posix/sim-posix.c <sources of ../../src and
+ *      ../../src/modules> <at-command sources> <lwgps sources> -o benchmark
+ *
+ * and run it against tools/modem-sim, which echoes socket data back:
+ *
+ *   ./modem-sim -l /tmp/ttySIM -b 921600 -n 100 &
+ *   ./benchmark -p /tmp/ttySIM -b 921600 > result.json
+ */
+
+#define _DEFAULT_SOURCE
+#include "../posix/sim-posix.h"
+#include "../../src/include/simcom/socket-client.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if !SIM_EN_FEATURE_SOCKET || !SIM_EN_FEATURE_HTTP || !SIM_EN_FEATURE_GPS || !SIM_EN_FEATURE_STATS
+#error "benchmark needs SIM_EN_FEATURE_SOCKET, _HTTP, _GPS and _STATS"
+#endif
+
+#define MAX_SENDS 4096
+
+static SIM_HandlerTypeDef hsim;
+static SIM_SocketClient_t sock;
+static uint8_t            sockBuffer[1500];
+
+static volatile uint8_t   sockConnected;
+static volatile uint32_t  sockReceived;       // onReceived calls
+static volatile uint32_t  sockReceivedBytes;  // copied into sockBuffer
+static volatile uint32_t  sockReceivedTick;   // of the last byte
+static int (*serialReadinto)(void *buffer, uint16_t sz);
+
+static struct {
+  volatile uint32_t start;
+  volatile uint32_t status;
+  volatile uint32_t head;
+  volatile uint32_t complete;
+  volatile uint32_t bytes;
+  volatile uint8_t  done;
+  volatile SIM_Status_t result;
+} httpTiming;
+
+static struct {
+  const char  *port;
+  uint32_t    baud;
+  const char  *host;
+  uint16_t    hostPort;
+  uint16_t    sends;
+  uint16_t    sendSize;
+  uint16_t    httpRequests;
+  const char  *url;
+  uint16_t    gpsSeconds;
+  uint32_t    timeout;
+} opt = {
+  .port         = "/tmp/ttySIM",
+  .baud         = 115200,
+  .host         = "127.0.0.1",
+  .hostPort     = 7,
+  .sends        = 200,
+  .sendSize     = 512,
+  .httpRequests = 10,
+  .url          = "http://127.0.0.1/",
+  .gpsSeconds   = 10,
+  .timeout      = 60000,
+};
+
+
+static uint8_t waitUntil(volatile uint8_t *flag, uint32_t timeout)
+{
+  uint32_t start = SIM_POSIX_GetTick();
+
+  while (!*flag) {
+    if (SIM_POSIX_GetTick() - start > timeout) return 0;
+    SIM_POSIX_Delay(1);
+  }
+  return 1;
+}
+
+static int compareU32(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+  return (x > y) - (x < y);
+}
+
+static uint32_t percentile(uint32_t *sorted, uint32_t n, uint8_t pct)
+{
+  if (n == 0) return 0;
+  return sorted[(n - 1) * pct / 100];
+}
+
+static void printStatsOf(const char *key, const char *cmd, uint8_t last)
+{
+  SIM_Stats_Cmd_t cmdStats;
+  uint8_t n = SIM_Stats_Count(&hsim.stats);
+
+  for (uint8_t i = 0; i < n; i++) {
+    if (SIM_Stats_Get(&hsim.stats, i, &cmdStats) != SIM_OK) continue;
+    if (strcmp(cmdStats.name, cmd) != 0) continue;
+
+    printf("      \"%s\": {\"calls\": %u, \"avg_ms\": %.2f, \"max_ms\": %u, \"errors\": %u}%s\n",
+           key, cmdStats.calls,
+           cmdStats.calls? (double) cmdStats.totalTime / cmdStats.calls: 0.0,
+           cmdStats.maxTime, cmdStats.errors + cmdStats.timeouts, last? "": ",");
+    return;
+  }
+  printf("      \"%s\": null%s\n", key, last? "": ",");
+}
+
+
+// socket listeners
+static void onConnected(void)           { sockConnected = 1; }
+static void onClosed(void)              { sockConnected = 0; }
+static void onReceived(void *buffer, uint16_t length)
+{
+  sockReceived++;
+}
+
+// AT handler thread, the socket payload is read into sockBuffer through here
+static int countingReadinto(void *buffer, uint16_t sz)
+{
+  int n = serialReadinto(buffer, sz);
+
+  if (buffer == sockBuffer && n > 0) {
+    sockReceivedBytes += n;
+    sockReceivedTick = SIM_POSIX_GetTick();
+  }
+  return n;
+}
+
+// http callbacks, called from the SIM thread
+static void onHttpStatus(SIM_HTTP_Async_t *req, uint16_t code, uint16_t contentLen)
+{
+  httpTiming.status = SIM_POSIX_GetTick();
+}
+
+static void onHttpHead(SIM_HTTP_Async_t *req, const void *head, uint16_t len)
+{
+  httpTiming.head = SIM_POSIX_GetTick();
+}
+
+static void onHttpData(SIM_HTTP_Async_t *req, const void *data, uint16_t len)
+{
+  httpTiming.bytes += len;
+}
+
+static void onHttpComplete(SIM_HTTP_Async_t *req, SIM_Status_t status)
+{
+  httpTiming.complete = SIM_POSIX_GetTick();
+  httpTiming.result = status;
+  httpTiming.done = 1;
+}
+
+
+static void benchBoot(void)
+{
+  uint8_t online = 0;
+  uint32_t start = SIM_POSIX_GetTick();
+
+  while (hsim.net.state != SIM_NET_STATE_ONLINE) {
+    if (SIM_POSIX_GetTick() - start > opt.timeout) break;
+    SIM_POSIX_Delay(5);
+  }
+  online = (hsim.net.state == SIM_NET_STATE_ONLINE);
+
+  // bootTiming is relative to tick.init, which onReady resets
+  printf("  \"boot\": {\"online\": %s, \"at_ready_ms\": %u, \"sim_ready_ms\": %u, "
+         "\"registered_ms\": %u, \"time_to_online_ms\": %u},\n",
+         online? "true": "false",
+         hsim.bootTiming.atReady, hsim.bootTiming.simReady,
+         hsim.bootTiming.registered, hsim.bootTiming.online);
+}
+
+static void benchSocket(void)
+{
+  static uint32_t latency[MAX_SENDS];
+  uint8_t  *payload = malloc(opt.sendSize);
+  uint16_t sends = (opt.sends > MAX_SENDS)? MAX_SENDS: opt.sends;
+  uint32_t sent = 0;
+  uint32_t failed = 0;
+  uint32_t start, end, t;
+  uint32_t expected;
+  uint8_t  received;
+
+  for (uint16_t i = 0; i < opt.sendSize; i++) payload[i] = (uint8_t) i;
+
+  sock.config.autoReconnect = 1;
+  sock.listeners.onConnected = onConnected;
+  sock.listeners.onClosed = onClosed;
+  sock.listeners.onReceived = onReceived;
+  SIM_SockClient_Init(&sock, opt.host, opt.hostPort, sockBuffer);
+  SIM_SockClient_Open(&sock, &hsim);
+
+  if (!waitUntil(&sockConnected, opt.timeout)) {
+    printf("  \"socket\": null,\n");
+    free(payload);
+    return;
+  }
+
+  sockReceived = 0;
+  sockReceivedBytes = 0;
+  start = SIM_POSIX_GetTick();
+  for (uint16_t i = 0; i < sends; i++) {
+    t = SIM_POSIX_GetTick();
+    if (SIM_SockClient_SendData(&sock, payload, opt.sendSize) != opt.sendSize) {
+      failed++;
+      continue;
+    }
+    latency[sent++] = SIM_POSIX_GetTick() - t;
+  }
+  end = SIM_POSIX_GetTick();
+
+  // the simulator echoes every send back, possibly split or merged
+  expected = sent * opt.sendSize;
+  t = SIM_POSIX_GetTick();
+  while (sockReceivedBytes < expected && SIM_POSIX_GetTick() - t < opt.timeout)
+    SIM_POSIX_Delay(1);
+  received = (sockReceivedBytes >= expected);
+
+  qsort(latency, sent, sizeof(uint32_t), compareU32);
+  printf("  \"socket\": {\n");
+  printf("    \"send_size\": %u, \"sends\": %u, \"failed\": %u,\n",
+         opt.sendSize, sent, failed);
+  printf("    \"send_throughput_Bps\": %.1f,\n",
+         (end > start)? (double) sent * opt.sendSize * 1000 / (end - start): 0.0);
+  printf("    \"send_latency_ms\": {\"min\": %u, \"p50\": %u, \"p90\": %u, \"p99\": %u, \"max\": %u},\n",
+         percentile(latency, sent, 0), percentile(latency, sent, 50),
+         percentile(latency, sent, 90), percentile(latency, sent, 99),
+         percentile(latency, sent, 100));
+  printf("    \"received_bytes\": %u, \"receives\": %u, \"receive_complete\": %s,\n",
+         sockReceivedBytes, sockReceived, received? "true": "false");
+  printf("    \"receive_throughput_Bps\": %.1f\n",
+         (sockReceivedTick > start)?
+             (double) sockReceivedBytes * 1000 / (sockReceivedTick - start): 0.0);
+  printf("  },\n");
+
+  SIM_SockClient_Close(&sock);
+  free(payload);
+}
+
+static void benchHttp(void)
+{
+  static uint8_t headBuffer[512];
+  static uint8_t contentBuffer[1024];
+  SIM_HTTP_Async_t req;
+  uint32_t ok = 0;
+  uint64_t toStatus = 0, toHead = 0, total = 0, bytes = 0;
+
+  SIM_Stats_Reset(&hsim.stats);
+
+  for (uint16_t i = 0; i < opt.httpRequests; i++) {
+    memset(&req, 0, sizeof(req));
+    memset((void*) &httpTiming, 0, sizeof(httpTiming));
+    req.req.url = (char*) opt.url;
+    req.req.method = 0;
+    req.resp.headBuffer = headBuffer;
+    req.resp.headBufferSize = sizeof(headBuffer);
+    req.resp.contentBuffer = contentBuffer;
+    req.resp.contentBufferSize = sizeof(contentBuffer);
+    req.timeout = opt.timeout;
+    req.onStatus = onHttpStatus;
+    req.onHead = onHttpHead;
+    req.onData = onHttpData;
+    req.onComplete = onHttpComplete;
+
+    httpTiming.start = SIM_POSIX_GetTick();
+    SIM_HTTP_RequestAsync(&hsim.http, &req);
+    if (!waitUntil(&httpTiming.done, opt.timeout * 2) || httpTiming.result != SIM_OK)
+      continue;
+
+    ok++;
+    toStatus += httpTiming.status - httpTiming.start;
+    toHead   += httpTiming.head - httpTiming.start;
+    total    += httpTiming.complete - httpTiming.start;
+    bytes    += httpTiming.bytes;
+  }
+
+  printf("  \"http\": {\n");
+  printf("    \"requests\": %u, \"ok\": %u, \"body_bytes\": %llu,\n",
+         opt.httpRequests, ok, (unsigned long long) bytes);
+  printf("    \"avg_ms\": {\"to_status\": %.2f, \"to_head\": %.2f, \"total\": %.2f},\n",
+         ok? (double) toStatus / ok: 0.0, ok? (double) toHead / ok: 0.0,
+         ok? (double) total / ok: 0.0);
+  // command round trips, +HTTPACTION only covers the command, not the URC
+  printf("    \"phases\": {\n");
+  printStatsOf("INIT", "+HTTPINIT", 0);
+  printStatsOf("ACTION", "+HTTPACTION", 0);
+  printStatsOf("HEAD", "+HTTPHEAD", 0);
+  printStatsOf("READ", "+HTTPREAD", 0);
+  printStatsOf("TERM", "+HTTPTERM", 1);
+  printf("    }\n");
+  printf("  },\n");
+}
+
+static void benchGps(void)
+{
+  uint32_t start, end, lines;
+  uint32_t waitStart = SIM_POSIX_GetTick();
+
+  // GPS is set up by the SIM thread once the modem is active
+  while (hsim.gps.state != SIM_GPS_STATE_ACTIVE && SIM_POSIX_GetTick() - waitStart < opt.timeout)
+    SIM_POSIX_Delay(5);
+  SIM_POSIX_Delay(1000);
+
+  lines = hsim.gps.nmeaLines;
+  start = SIM_POSIX_GetTick();
+  SIM_POSIX_Delay(opt.gpsSeconds * 1000);
+  end = SIM_POSIX_GetTick();
+  lines = hsim.gps.nmeaLines - lines;
+
+  printf("  \"gps\": {\"active\": %s, \"seconds\": %.2f, \"nmea_lines\": %u, "
+         "\"nmea_lines_per_sec\": %.1f}\n",
+         (hsim.gps.state == SIM_GPS_STATE_ACTIVE)? "true": "false",
+         (double) (end - start) / 1000, lines,
+         (end > start)? (double) lines * 1000 / (end - start): 0.0);
+}
+
+
+static void usage(void)
+{
+  fprintf(stderr,
+      "usage: benchmark [-p port] [-b baud] [-H host] [-P port] [-n sends] [-s size]\n"
+      "                 [-r http requests] [-u url] [-g gps seconds] [-t timeout ms]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv)
+{
+  SIM_GPS_Config_t gpsConfig = {
+    .accuracy       = 50,
+    .antenaMode     = SIM_GPS_ANT_PASSIVE,
+    .outputRate     = SIM_GPS_NMEARATE_10HZ,
+    .reportInterval = 1,
+    .NMEA           = 0x01FF,     // all sentences
+    .MOAGPS_Method  = SIM_GPS_METHOD_USER_PLANE,
+  };
+  int c;
+  int fd;
+
+  while ((c = getopt(argc, argv, "p:b:H:P:n:s:r:u:g:t:")) != -1) {
+    switch (c) {
+    case 'p': opt.port = optarg; break;
+    case 'b': opt.baud = (uint32_t) atoi(optarg); break;
+    case 'H': opt.host = optarg; break;
+    case 'P': opt.hostPort = (uint16_t) atoi(optarg); break;
+    case 'n': opt.sends = (uint16_t) atoi(optarg); break;
+    case 's': opt.sendSize = (uint16_t) atoi(optarg); break;
+    case 'r': opt.httpRequests = (uint16_t) atoi(optarg); break;
+    case 'u': opt.url = optarg; break;
+    case 'g': opt.gpsSeconds = (uint16_t) atoi(optarg); break;
+    case 't': opt.timeout = (uint32_t) atoi(optarg); break;
+    default: usage();
+    }
+  }
+  if (opt.sendSize > sizeof(sockBuffer)) opt.sendSize = sizeof(sockBuffer);
+
+  fd = SIM_POSIX_OpenSerial(opt.port, opt.baud);
+  if (fd < 0) {
+    perror(opt.port);
+    return 1;
+  }
+
+  SIM_POSIX_Setup(&hsim, fd);
+  serialReadinto = hsim.serial.readinto;
+  hsim.serial.readinto = countingReadinto;
+  SIM_GPS_SetupConfig(&hsim.gps, &gpsConfig);
+  if (SIM_Init(&hsim) != SIM_OK) {
+    fprintf(stderr, "benchmark: SIM_Init failed\n");
+    return 1;
+  }
+  SIM_NET_SetupAPN(&hsim.net, "internet", "", "");
+  SIM_POSIX_Start(&hsim);
+
+  printf("{\n");
+  printf("  \"config\": {\"port\": \"%s\", \"baud\": %u},\n", opt.port, opt.baud);
+  benchBoot();
+  benchSocket();
+  benchHttp();
+  benchGps();
+  printf("}\n");
+  fflush(stdout);
+
+  return 0;
+}
@@ -0,0 +1,675 @@
+/*
+ * modem-sim.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ *
+ * Host side modem emulator speaking the AT dialect used by the library over
+ * a pseudo-terminal. Build and run:
+ *
+ *   cc -O2 -o modem-sim modem-sim.c
+ *   ./modem-sim -l /tmp/ttySIM -b 115200 -d 20 -L +CIPOPEN=300 -s urc.txt
+ *
+ * Script lines (see script-example.txt):
+ *   at <ms> <line>         emit <line> <ms> after start
+ *   after <CMD> <ms> <line> emit <line> <ms> after every <CMD> was answered
+ *   latency <CMD> <ms>     same as -L
+ *   # comment
+ */
+
+#define _XOPEN_SOURCE 700
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_LINE        1024
+#define MAX_EVENTS      256
+#define MAX_RULES       64
+#define MAX_SOCKETS     10
+#define TX_BUFFER_SIZE  (64*1024)
+
+typedef struct {
+  uint64_t  due;
+  uint16_t  len;
+  char      *data;
+} Event_t;
+
+typedef struct {
+  char      cmd[24];
+  uint32_t  latency;
+  uint32_t  delay;
+  char      *urc;         // "after" rule when set, latency rule otherwise
+} Rule_t;
+
+static struct {
+  int       master;
+  int       slave;
+  uint32_t  baud;
+  uint32_t  latency;
+  uint16_t  httpBodySize;
+  uint32_t  nmeaInterval;
+  uint8_t   verbose;
+
+  Event_t   events[MAX_EVENTS];
+  uint16_t  eventsNb;
+  Rule_t    rules[MAX_RULES];
+  uint8_t   rulesNb;
+
+  uint8_t   tx[TX_BUFFER_SIZE];
+  uint32_t  txHead;
+  uint32_t  txLen;
+  uint64_t  txTick;       // line time up to which bytes were sent, us
+
+  char      line[MAX_LINE];
+  uint16_t  lineLen;
+
+  // pending "> " prompt payload
+  int       rawLink;      // socket link, -1 for file upload
+  uint32_t  rawRemaining;
+  uint32_t  rawLen;
+  uint8_t   rawActive;
+
+  uint8_t   echo;
+  uint8_t   netOpen;
+  uint8_t   sockets[MAX_SOCKETS];
+  uint8_t   gpsOn;
+  uint64_t  nextNmea;
+  uint8_t   httpOn;
+  uint16_t  httpReadPos;
+} sim;
+
+
+static uint64_t nowUs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t nowMs(void)
+{
+  return nowUs() / 1000;
+}
+
+
+static void txPush(const void *data, uint32_t len)
+{
+  const uint8_t *src = data;
+
+  if (sim.txLen + len > TX_BUFFER_SIZE) {
+    fprintf(stderr, "modem-sim: tx overflow, %u bytes dropped\n", len);
+    return;
+  }
+  for (uint32_t i = 0; i < len; i++) {
+    sim.tx[(sim.txHead + sim.txLen + i) % TX_BUFFER_SIZE] = src[i];
+  }
+  sim.txLen += len;
+}
+
+// writes as many bytes as the emulated baud rate allowed since the last call
+static void txFlush(void)
+{
+  uint64_t now = nowUs();
+  uint32_t allowed;
+  uint32_t chunk;
+  ssize_t  written;
+
+  if (sim.txLen == 0) {
+    sim.txTick = now;
+    return;
+  }
+  if (sim.baud == 0) {
+    allowed = sim.txLen;
+  } else {
+    if (sim.txTick > now) return;
+    allowed = (uint32_t) ((now - sim.txTick) * sim.baud / 10 / 1000000);
+    if (allowed == 0) return;
+    if (allowed > sim.txLen) allowed = sim.txLen;
+  }
+
+  while (allowed > 0) {
+    chunk = TX_BUFFER_SIZE - sim.txHead;
+    if (chunk > allowed) chunk = allowed;
+    written = write(sim.master, &sim.tx[sim.txHead], chunk);
+    if (written <= 0) break;
+
+    sim.txHead = (sim.txHead + written) % TX_BUFFER_SIZE;
+    sim.txLen -= written;
+    allowed -= written;
+    if (sim.baud != 0)
+      sim.txTick += (uint64_t) written * 10 * 1000000 / sim.baud;
+  }
+}
+
+
+static void schedule(uint32_t delayMs, const void *data, uint16_t len)
+{
+  Event_t *evt;
+  uint16_t i;
+
+  if (sim.eventsNb >= MAX_EVENTS) {
+    fprintf(stderr, "modem-sim: event queue full\n");
+    return;
+  }
+
+  // keep the queue sorted, equal due times stay in order
+  uint64_t due = nowMs() + delayMs;
+  for (i = sim.eventsNb; i > 0 && sim.events[i-1].due > due; i--) {
+    sim.events[i] = sim.events[i-1];
+  }
+  evt = &sim.events[i];
+  evt->due = due;
+  evt->len = len;
+  evt->data = malloc(len);
+  memcpy(evt->data, data, len);
+  sim.eventsNb++;
+}
+
+static void scheduleLine(uint32_t delayMs, const char *line)
+{
+  char buf[MAX_LINE];
+  int len = snprintf(buf, sizeof(buf), "\r\n%s\r\n", line);
+
+  schedule(delayMs, buf, len);
+}
+
+static void runEvents(void)
+{
+  uint64_t now = nowMs();
+
+  while (sim.eventsNb > 0 && sim.events[0].due <= now) {
+    txPush(sim.events[0].data, sim.events[0].len);
+    if (sim.verbose) fprintf(stderr, "<< %.*s\n", sim.events[0].len, sim.events[0].data);
+    free(sim.events[0].data);
+    sim.eventsNb--;
+    memmove(&sim.events[0], &sim.events[1], sim.eventsNb * sizeof(Event_t));
+  }
+}
+
+
+static uint32_t latencyOf(const char *cmd)
+{
+  for (uint8_t i = 0; i < sim.rulesNb; i++) {
+    if (sim.rules[i].urc == 0 && strcmp(sim.rules[i].cmd, cmd) == 0)
+      return sim.rules[i].latency;
+  }
+  return sim.latency;
+}
+
+static void runAfterRules(const char *cmd, uint32_t latency)
+{
+  for (uint8_t i = 0; i < sim.rulesNb; i++) {
+    if (sim.rules[i].urc != 0 && strcmp(sim.rules[i].cmd, cmd) == 0)
+      scheduleLine(latency + sim.rules[i].delay, sim.rules[i].urc);
+  }
+}
+
+static void addRule(const char *cmd, uint32_t latency, uint32_t delay, const char *urc)
+{
+  Rule_t *rule;
+
+  if (sim.rulesNb >= MAX_RULES) return;
+  rule = &sim.rules[sim.rulesNb++];
+  snprintf(rule->cmd, sizeof(rule->cmd), "%s", cmd);
+  rule->latency = latency;
+  rule->delay = delay;
+  rule->urc = (urc != 0)? strdup(urc): 0;
+}
+
+
+// splits "a,\"b,c\",d" into arguments, quotes are removed
+static int splitArgs(char *params, char **argv, int max)
+{
+  int argc = 0;
+  char *p = params;
+
+  while (p != 0 && *p != 0 && argc < max) {
+    if (*p == '"') {
+      argv[argc++] = ++p;
+      p = strchr(p, '"');
+      if (p == 0) break;
+      *p++ = 0;
+      if (*p == ',') p++;
+    } else {
+      argv[argc++] = p;
+      p = strchr(p, ',');
+      if (p != 0) *p++ = 0;
+    }
+  }
+  return argc;
+}
+
+static void nmeaSentence(const char *body)
+{
+  char buf[128];
+  uint8_t sum = 0;
+
+  for (const char *c = body; *c; c++) sum ^= (uint8_t) *c;
+  snprintf(buf, sizeof(buf), "$%s*%02X", body, sum);
+  scheduleLine(0, buf);
+}
+
+static void emitNmea(void)
+{
+  time_t t = time(0);
+  struct tm tm;
+  char body[100];
+
+  gmtime_r(&t, &tm);
+  snprintf(body, sizeof(body),
+           "GPGGA,%02d%02d%02d.00,0612.3456,S,10648.1234,E,1,08,0.9,45.0,M,0.0,M,,",
+           tm.tm_hour, tm.tm_min, tm.tm_sec);
+  nmeaSentence(body);
+  snprintf(body, sizeof(body),
+           "GPRMC,%02d%02d%02d.00,A,0612.3456,S,10648.1234,E,0.0,0.0,%02d%02d%02d,,,A",
+           tm.tm_hour, tm.tm_min, tm.tm_sec, tm.tm_mday, tm.tm_mon+1, tm.tm_year%100);
+  nmeaSentence(body);
+}
+
+
+// answers one command of the line, returns 0 when the result code is emitted
+// by the handler itself
+static int handleCommand(char *cmd, char *out, size_t outSize, uint32_t latency)
+{
+  char name[24];
+  char *params = 0;
+  char *argv[8];
+  int  argc = 0;
+  char query = 0;
+  char urc[MAX_LINE];
+  size_t n = 0;
+  size_t len = strcspn(cmd, "=?");
+
+  if (len >= sizeof(name)) len = sizeof(name) - 1;
+  memcpy(name, cmd, len);
+  name[len] = 0;
+  if (cmd[len] == '?') query = 1;
+  else if (cmd[len] == '=') {
+    params = cmd + len + 1;
+    if (strcmp(params, "?") == 0) query = 2;
+    else argc = splitArgs(params, argv, 8);
+  }
+
+#define OUT(...) (n += snprintf(out + n, outSize - n, __VA_ARGS__))
+
+  if (name[0] == 0) {
+    // plain AT
+  }
+  else if (strcmp(name, "E0") == 0) sim.echo = 0;
+  else if (strcmp(name, "E1") == 0) sim.echo = 1;
+  else if (strcmp(name, "+CPIN") == 0 && query) OUT("\r\n+CPIN: READY\r\n");
+  else if (strcmp(name, "+CSQ") == 0) OUT("\r\n+CSQ: 20,99\r\n");
+  else if (strcmp(name, "+CREG") == 0 && query) OUT("\r\n+CREG: 0,1\r\n");
+  else if (strcmp(name, "+CGREG") == 0 && query) OUT("\r\n+CGREG: 0,1\r\n");
+  else if (strcmp(name, "+CEREG") == 0 && query) OUT("\r\n+CEREG: 0,1\r\n");
+  else if (strcmp(name, "+COPS") == 0 && query) OUT("\r\n+COPS: 0,2,\"51010\",7\r\n");
+  else if (strcmp(name, "+CPSI") == 0 && query) {
+    OUT("\r\n+CPSI: LTE,Online,510-10,0x1A2B,12345678,123,EUTRAN-BAND3,1850,5,5,-10,-95,-65,12\r\n");
+  }
+  else if (strcmp(name, "+CCLK") == 0 && query) {
+    time_t t = time(0);
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    OUT("\r\n+CCLK: \"%02d/%02d/%02d,%02d:%02d:%02d+00\"\r\n",
+        tm.tm_year % 100, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+  }
+  else if (strcmp(name, "+CNTP") == 0 && params == 0 && !query) {
+    scheduleLine(latency + 500, "+CNTP: 0");
+  }
+  else if (strcmp(name, "+NETOPEN") == 0) {
+    if (query) OUT("\r\n+NETOPEN: %d\r\n", sim.netOpen);
+    else {
+      sim.netOpen = 1;
+      scheduleLine(latency + 50, "+NETOPEN: 0");
+    }
+  }
+  else if (strcmp(name, "+NETCLOSE") == 0) {
+    sim.netOpen = 0;
+    memset(sim.sockets, 0, sizeof(sim.sockets));
+    scheduleLine(latency + 50, "+NETCLOSE: 0");
+  }
+  else if (strcmp(name, "+CIPOPEN") == 0 && argc >= 1) {
+    int link = atoi(argv[0]);
+    if (link < 0 || link >= MAX_SOCKETS || !sim.netOpen) return -1;
+    sim.sockets[link] = 1;
+    snprintf(urc, sizeof(urc), "+CIPOPEN: %d,0", link);
+    scheduleLine(latency + 100, urc);
+  }
+  else if (strcmp(name, "+CIPCLOSE") == 0 && argc >= 1) {
+    int link = atoi(argv[0]);
+    if (link < 0 || link >= MAX_SOCKETS) return -1;
+    sim.sockets[link] = 0;
+    snprintf(urc, sizeof(urc), "+CIPCLOSE: %d,0", link);
+    scheduleLine(latency + 20, urc);
+  }
+  else if (strcmp(name, "+CIPSEND") == 0 && argc >= 2) {
+    int link = atoi(argv[0]);
+    if (link < 0 || link >= MAX_SOCKETS || !sim.sockets[link]) return -1;
+    sim.rawActive = 1;
+    sim.rawLink = link;
+    sim.rawLen = sim.rawRemaining = (uint32_t) atoi(argv[1]);
+    schedule(latency, "\r\n>", 3);
+    return 0;
+  }
+  else if (strcmp(name, "+CFTRANRX") == 0 && argc >= 2) {
+    sim.rawActive = 1;
+    sim.rawLink = -1;
+    sim.rawLen = sim.rawRemaining = (uint32_t) atoi(argv[1]);
+    schedule(latency, "\r\n>", 3);
+    return 0;
+  }
+  else if (strcmp(name, "+FSMEM") == 0) OUT("\r\n+FSMEM: C:(11348480,2201600),E:(1000000,0)\r\n");
+  else if (strcmp(name, "+CGPS") == 0 && argc >= 1) {
+    sim.gpsOn = atoi(argv[0]);
+    sim.nextNmea = nowMs() + sim.nmeaInterval;
+  }
+  else if (strcmp(name, "+HTTPINIT") == 0) {
+    if (sim.httpOn) return -1;
+    sim.httpOn = 1;
+    sim.httpReadPos = 0;
+  }
+  else if (strcmp(name, "+HTTPTERM") == 0) sim.httpOn = 0;
+  else if ((strcmp(name, "+HTTPACTION") == 0 || strcmp(name, "+HTTPPOSTFILE") == 0)
+           && argc >= 1) {
+    int method = atoi(argv[(strcmp(name, "+HTTPACTION") == 0)? 0: (argc - 1)]);
+    if (!sim.httpOn) return -1;
+    sim.httpReadPos = 0;
+    snprintf(urc, sizeof(urc), "%s: %d,200,%u", name, method, sim.httpBodySize);
+    scheduleLine(latency + 200, urc);
+  }
+  else if (strcmp(name, "+HTTPHEAD") == 0) {
+    char head[128];
+    int headLen = snprintf(head, sizeof(head),
+                           "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n", sim.httpBodySize);
+    OUT("\r\n+HTTPHEAD: %d\r\n%s", headLen, head);
+  }
+  else if (strcmp(name, "+HTTPREAD") == 0 && argc >= 2) {
+    uint32_t size = (uint32_t) atoi(argv[1]);
+    uint32_t left = sim.httpBodySize - sim.httpReadPos;
+    char *body;
+
+    if (size > left) size = left;
+    OUT("\r\nOK\r\n\r\n+HTTPREAD: DATA,%u\r\n", size);
+    body = malloc(n + size + 24);
+    memcpy(body, out, n);
+    for (uint32_t i = 0; i < size; i++) body[n + i] = 'a' + (sim.httpReadPos + i) % 26;
+    sim.httpReadPos += size;
+    n += size;
+    n += sprintf(body + n, "\r\n+HTTPREAD: 0\r\n");
+    schedule(latency, body, n);
+    free(body);
+    return 0;
+  }
+  // anything else is accepted as a setter
+
+#undef OUT
+
+  return (int) n;
+}
+
+// a line can hold several commands joined by ';' (SIM_CommandBatch)
+static void handleLine(char *line)
+{
+  char out[4096];
+  char *cmds[16];
+  int  cmdsNb = 0;
+  int  result = 0;
+  size_t n = 0;
+  uint32_t latency;
+  char inQuote = 0;
+  char first[24];
+
+  if (sim.verbose) fprintf(stderr, ">> %s\n", line);
+  if (sim.echo) {
+    txPush(line, strlen(line));
+    txPush("\r", 1);
+  }
+  if (strncasecmp(line, "AT", 2) != 0) return;
+
+  cmds[cmdsNb++] = line + 2;
+  for (char *p = line + 2; *p; p++) {
+    if (*p == '"') inQuote = !inQuote;
+    else if (*p == ';' && !inQuote && cmdsNb < 16) {
+      *p = 0;
+      cmds[cmdsNb++] = p + 1;
+    }
+  }
+
+  snprintf(first, sizeof(first), "%.*s", (int) strcspn(cmds[0], "=?"), cmds[0]);
+  latency = latencyOf(first);
+
+  for (int i = 0; i < cmdsNb; i++) {
+    char name[24];
+    snprintf(name, sizeof(name), "%.*s", (int) strcspn(cmds[i], "=?"), cmds[i]);
+
+    result = handleCommand(cmds[i], out + n, sizeof(out) - n, latency);
+    if (result < 0) break;
+    if (result == 0 && sim.rawActive) {
+      // prompt was scheduled, result code follows the payload
+      runAfterRules(name, latency);
+      return;
+    }
+    n += result;
+    runAfterRules(name, latency);
+    if (result == 0 && strcmp(name, "+HTTPREAD") == 0) return;
+  }
+
+  n += snprintf(out + n, sizeof(out) - n, (result < 0)? "\r\nERROR\r\n": "\r\nOK\r\n");
+  schedule(latency, out, n);
+}
+
+static void finishRaw(void)
+{
+  char buf[128];
+  int n;
+
+  sim.rawActive = 0;
+  if (sim.rawLink < 0) {
+    schedule(sim.latency, "\r\nOK\r\n", 6);
+    return;
+  }
+  n = snprintf(buf, sizeof(buf), "\r\nOK\r\n\r\n+CIPSEND: %d,%u,%u\r\n",
+               sim.rawLink, sim.rawLen, sim.rawLen);
+  schedule(sim.latency, buf, n);
+}
+
+static void onRx(const uint8_t *data, ssize_t len)
+{
+  static uint8_t echoBuf[4096];
+  static uint32_t echoLen;
+
+  for (ssize_t i = 0; i < len; i++) {
+    uint8_t c = data[i];
+
+    if (sim.rawActive) {
+      // socket payload is echoed back as if the server answered
+      if (sim.rawLink >= 0 && echoLen < sizeof(echoBuf)) echoBuf[echoLen++] = c;
+      if (--sim.rawRemaining == 0) {
+        finishRaw();
+        if (sim.rawLink >= 0) {
+          char head[48];
+          int n = snprintf(head, sizeof(head), "\r\n+RECEIVE,%d,%u\r\n", sim.rawLink, echoLen);
+          uint8_t *urc = malloc(n + echoLen);
+          memcpy(urc, head, n);
+          memcpy(urc + n, echoBuf, echoLen);
+          schedule(sim.latency + 50, urc, n + echoLen);
+          free(urc);
+          echoLen = 0;
+        }
+      }
+      continue;
+    }
+
+    if (c == '\r' || c == '\n') {
+      if (sim.lineLen == 0) continue;
+      sim.line[sim.lineLen] = 0;
+      sim.lineLen = 0;
+      handleLine(sim.line);
+    }
+    else if (sim.lineLen < MAX_LINE - 1) {
+      sim.line[sim.lineLen++] = c;
+    }
+  }
+}
+
+
+static void loadScript(const char *path)
+{
+  FILE *f = fopen(path, "r");
+  char line[MAX_LINE];
+  char cmd[24];
+  unsigned ms;
+  int off;
+
+  if (f == 0) {
+    perror(path);
+    exit(1);
+  }
+  while (fgets(line, sizeof(line), f)) {
+    line[strcspn(line, "\r\n")] = 0;
+    if (line[0] == '#' || line[0] == 0) continue;
+
+    if (sscanf(line, "at %u %n", &ms, &off) == 1) {
+      scheduleLine(ms, line + off);
+    }
+    else if (sscanf(line, "after %23s %u %n", cmd, &ms, &off) == 2) {
+      addRule(cmd, 0, ms, line + off);
+    }
+    else if (sscanf(line, "latency %23s %u", cmd, &ms) == 2) {
+      addRule(cmd, ms, 0, 0);
+    }
+    else {
+      fprintf(stderr, "modem-sim: bad script line: %s\n", line);
+    }
+  }
+  fclose(f);
+}
+
+static void usage(void)
+{
+  fprintf(stderr,
+      "usage: modem-sim [-l link] [-b baud] [-d ms] [-L CMD=ms]... [-s script]\n"
+      "                 [-r ms] [-H bytes] [-n ms] [-v]\n"
+      "  -l  symlink pointing to the pty slave\n"
+      "  -b  emulated baud rate, 0 writes without throttling (default 115200)\n"
+      "  -d  default command latency in ms (default 10)\n"
+      "  -L  latency of one command, e.g. -L +CIPOPEN=300\n"
+      "  -s  URC script\n"
+      "  -r  delay before RDY in ms (default 500)\n"
+      "  -H  http body size (default 1024)\n"
+      "  -n  NMEA interval once +CGPS=1 (default 1000)\n");
+  exit(2);
+}
+
+int main(int argc, char **argv)
+{
+  const char *link = 0;
+  const char *script = 0;
+  uint32_t rdyDelay = 500;
+  struct termios tio;
+  uint8_t buf[1024];
+  int opt;
+
+  sim.baud = 115200;
+  sim.latency = 10;
+  sim.httpBodySize = 1024;
+  sim.nmeaInterval = 1000;
+  sim.echo = 1;
+
+  while ((opt = getopt(argc, argv, "l:b:d:L:s:r:H:n:v")) != -1) {
+    switch (opt) {
+    case 'l': link = optarg; break;
+    case 'b': sim.baud = (uint32_t) atoi(optarg); break;
+    case 'd': sim.latency = (uint32_t) atoi(optarg); break;
+    case 'L': {
+      char *eq = strchr(optarg, '=');
+      if (eq == 0) usage();
+      *eq = 0;
+      addRule(optarg, (uint32_t) atoi(eq + 1), 0, 0);
+      break;
+    }
+    case 's': script = optarg; break;
+    case 'r': rdyDelay = (uint32_t) atoi(optarg); break;
+    case 'H': sim.httpBodySize = (uint16_t) atoi(optarg); break;
+    case 'n': sim.nmeaInterval = (uint32_t) atoi(optarg); break;
+    case 'v': sim.verbose = 1; break;
+    default: usage();
+    }
+  }
+
+  sim.master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (sim.master < 0 || grantpt(sim.master) < 0 || unlockpt(sim.master) < 0) {
+    perror("posix_openpt");
+    return 1;
+  }
+
+  // the slave stays open so the master does not see EIO between clients
+  sim.slave = open(ptsname(sim.master), O_RDWR | O_NOCTTY);
+  tcgetattr(sim.slave, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(sim.slave, TCSANOW, &tio);
+
+  if (link != 0) {
+    unlink(link);
+    if (symlink(ptsname(sim.master), link) < 0) {
+      perror(link);
+      return 1;
+    }
+  }
+  printf("%s\n", ptsname(sim.master));
+  fflush(stdout);
+  signal(SIGPIPE, SIG_IGN);
+
+  sim.txTick = nowUs();
+  scheduleLine(rdyDelay, "RDY");
+  scheduleLine(rdyDelay + 200, "+CPIN: READY");
+  scheduleLine(rdyDelay + 1000, "SMS DONE");
+  scheduleLine(rdyDelay + 1000, "PB DONE");
+  if (script != 0) loadScript(script);
+
+  for (;;) {
+    fd_set rfds;
+    struct timeval tv;
+    uint64_t now = nowMs();
+    uint64_t wait = 100;
+    ssize_t len;
+
+    if (sim.gpsOn && sim.nmeaInterval > 0 && now >= sim.nextNmea) {
+      emitNmea();
+      sim.nextNmea = now + sim.nmeaInterval;
+    }
+    runEvents();
+    txFlush();
+
+    if (sim.eventsNb > 0)
+      wait = (sim.events[0].due > now)? sim.events[0].due - now: 0;
+    if (sim.txLen > 0 && wait > 1) wait = 1;
+
+    FD_ZERO(&rfds);
+    FD_SET(sim.master, &rfds);
+    tv.tv_sec = wait / 1000;
+    tv.tv_usec = (wait % 1000) * 1000;
+    if (select(sim.master + 1, &rfds, 0, 0, &tv) < 0) {
+      if (errno == EINTR) continue;
+      perror("select");
+      break;
+    }
+    if (FD_ISSET(sim.master, &rfds)) {
+      len = read(sim.master, buf, sizeof(buf));
+      if (len > 0) onRx(buf, len);
+    }
+  }
+
+  if (link != 0) unlink(link);
+  return 0;
+}
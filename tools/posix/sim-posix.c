@@ -0,0 +1,253 @@
+/*
+ * sim-posix.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ */
+
+#define _DEFAULT_SOURCE
+#include "sim-posix.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+static struct {
+  int             fd;
+  uint8_t         rx[1024];
+  uint16_t        rxPos;
+  uint16_t        rxLen;
+
+  pthread_mutex_t cmdMutex;
+  pthread_mutex_t evtMutex;
+  pthread_cond_t  evtCond;
+  uint32_t        events;
+} port = {
+  .fd       = -1,
+  .cmdMutex = PTHREAD_MUTEX_INITIALIZER,
+  .evtMutex = PTHREAD_MUTEX_INITIALIZER,
+  .evtCond  = PTHREAD_COND_INITIALIZER,
+};
+
+
+static speed_t toSpeed(uint32_t baud)
+{
+  switch (baud) {
+  case 9600:    return B9600;
+  case 57600:   return B57600;
+  case 230400:  return B230400;
+  case 460800:  return B460800;
+  case 921600:  return B921600;
+  case 115200:
+  default:      return B115200;
+  }
+}
+
+int SIM_POSIX_OpenSerial(const char *path, uint32_t baud)
+{
+  struct termios tio;
+  int fd = open(path, O_RDWR | O_NOCTTY);
+
+  if (fd < 0) return -1;
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, toSpeed(baud));
+    cfsetospeed(&tio, toSpeed(baud));
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+  return fd;
+}
+
+
+uint32_t SIM_POSIX_GetTick(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t) (ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+void SIM_POSIX_Delay(uint32_t ms)
+{
+  usleep(ms * 1000);
+}
+
+static void deadlineAfter(struct timespec *ts, uint32_t ms)
+{
+  clock_gettime(CLOCK_REALTIME, ts);
+  ts->tv_sec  += ms / 1000;
+  ts->tv_nsec += (long) (ms % 1000) * 1000000;
+  if (ts->tv_nsec >= 1000000000) {
+    ts->tv_sec++;
+    ts->tv_nsec -= 1000000000;
+  }
+}
+
+
+// serial, only the AT handler thread reads
+static int fill(void)
+{
+  ssize_t len;
+
+  if (port.rxPos < port.rxLen) return 1;
+  do {
+    len = read(port.fd, port.rx, sizeof(port.rx));
+  } while (len < 0 && errno == EINTR);
+  if (len <= 0) return 0;
+
+  port.rxPos = 0;
+  port.rxLen = (uint16_t) len;
+  return 1;
+}
+
+static int serialRead(uint8_t *dst, uint16_t sz)
+{
+  uint16_t n = 0;
+
+  while (n < sz && fill()) {
+    dst[n++] = port.rx[port.rxPos++];
+  }
+  return n;
+}
+
+static int serialReadline(uint8_t *dst, uint16_t sz)
+{
+  uint16_t n = 0;
+
+  while (n < sz && fill()) {
+    dst[n] = port.rx[port.rxPos++];
+    if (dst[n++] == '\n') break;
+  }
+  return n;
+}
+
+static int serialReadinto(void *buffer, uint16_t sz)
+{
+  uint8_t drop;
+
+  if (buffer != 0) return serialRead(buffer, sz);
+
+  // no buffer registered for the data, skip it
+  for (uint16_t i = 0; i < sz; i++) {
+    if (serialRead(&drop, 1) != 1) return i;
+  }
+  return sz;
+}
+
+static int serialWrite(uint8_t *src, uint16_t sz)
+{
+  uint16_t n = 0;
+  ssize_t  written;
+
+  while (n < sz) {
+    written = write(port.fd, src + n, sz - n);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) break;
+    n += written;
+  }
+  return n;
+}
+
+
+// rtos
+static AT_Status_t mutexLock(uint32_t timeout)
+{
+  struct timespec ts;
+
+  deadlineAfter(&ts, timeout);
+  if (pthread_mutex_timedlock(&port.cmdMutex, &ts) != 0) return AT_TIMEOUT;
+  return AT_OK;
+}
+
+static AT_Status_t mutexUnlock(void)
+{
+  pthread_mutex_unlock(&port.cmdMutex);
+  return AT_OK;
+}
+
+static AT_Status_t eventSet(uint32_t events)
+{
+  pthread_mutex_lock(&port.evtMutex);
+  port.events |= events;
+  pthread_cond_broadcast(&port.evtCond);
+  pthread_mutex_unlock(&port.evtMutex);
+  return AT_OK;
+}
+
+// any of waitEvents, the received ones are cleared as with osEventFlagsWait
+static AT_Status_t eventWait(uint32_t waitEvents, uint32_t *onEvents, uint32_t timeout)
+{
+  struct timespec ts;
+  AT_Status_t status = AT_OK;
+
+  deadlineAfter(&ts, timeout);
+  pthread_mutex_lock(&port.evtMutex);
+  while ((port.events & waitEvents) == 0) {
+    if (pthread_cond_timedwait(&port.evtCond, &port.evtMutex, &ts) == ETIMEDOUT) {
+      status = AT_TIMEOUT;
+      break;
+    }
+  }
+  *onEvents = port.events & waitEvents;
+  port.events &= ~waitEvents;
+  pthread_mutex_unlock(&port.evtMutex);
+  return status;
+}
+
+static AT_Status_t eventClear(uint32_t events)
+{
+  pthread_mutex_lock(&port.evtMutex);
+  port.events &= ~events;
+  pthread_mutex_unlock(&port.evtMutex);
+  return AT_OK;
+}
+
+
+void SIM_POSIX_Setup(SIM_HandlerTypeDef *hsim, int fd)
+{
+  port.fd = fd;
+
+  hsim->delay       = SIM_POSIX_Delay;
+  hsim->getTick     = SIM_POSIX_GetTick;
+
+  hsim->serial.read     = serialRead;
+  hsim->serial.readline = serialReadline;
+  hsim->serial.readinto = serialReadinto;
+  hsim->serial.write    = serialWrite;
+
+  hsim->rtos.mutexLock    = mutexLock;
+  hsim->rtos.mutexUnlock  = mutexUnlock;
+  hsim->rtos.eventSet     = eventSet;
+  hsim->rtos.eventWait    = eventWait;
+  hsim->rtos.eventClear   = eventClear;
+}
+
+
+static void* atcThread(void *arg)
+{
+  for (;;) SIM_Thread_ATCHandler(arg);
+  return 0;
+}
+
+static void* simThread(void *arg)
+{
+  for (;;) SIM_Thread_Run(arg);
+  return 0;
+}
+
+// runs the AT handler and the SIM thread, call after SIM_Init
+int SIM_POSIX_Start(SIM_HandlerTypeDef *hsim)
+{
+  pthread_t thread;
+
+  if (pthread_create(&thread, 0, atcThread, hsim) != 0) return -1;
+  pthread_detach(thread);
+  if (pthread_create(&thread, 0, simThread, hsim) != 0) return -1;
+  pthread_detach(thread);
+  return 0;
+}
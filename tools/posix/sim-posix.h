@@ -0,0 +1,24 @@
+/*
+ * sim-posix.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ *
+ * serial/rtos callbacks of SIM_HandlerTypeDef on top of a tty and pthreads,
+ * for running the library on a Linux host (with tools/modem-sim or a modem on
+ * a USB serial adapter). The callbacks carry no context, so one instance per
+ * process.
+ */
+
+#ifndef SIM_POSIX_H_
+#define SIM_POSIX_H_
+
+#include "../../src/include/simcom.h"
+
+int       SIM_POSIX_OpenSerial(const char *path, uint32_t baud);
+void      SIM_POSIX_Setup(SIM_HandlerTypeDef*, int fd);
+int       SIM_POSIX_Start(SIM_HandlerTypeDef*);
+uint32_t  SIM_POSIX_GetTick(void);
+void      SIM_POSIX_Delay(uint32_t ms);
+
+#endif /* SIM_POSIX_H_ */
@@ -0,0 +1,154 @@
+/*
+ * trace-decode.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: janoko
+ *
+ * Prints a state-transition trace written by SIM_Trace_Dump, one line per
+ * record. The dump is read from a file or stdin, fields are little endian
+ * as written by the targets this library runs on.
+ *
+ *   cc -O2 -o trace-decode trace-decode.c
+ *   ./trace-decode trace.bin
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// keep in sync with src/include/simcom/trace.h
+#define TRACE_MAGIC       0x544D4953UL
+#define TRACE_VERSION     1
+#define TRACE_HEADER_SIZE 12
+
+#define NAMES(arr, i) (((i) < sizeof(arr)/sizeof(arr[0]))? arr[i]: "?")
+
+static const char *modules[] = {
+  "core", "net", "sockmgr", "socket", "gps", "http", "power", "watchdog",
+};
+
+static const char *causes[] = {
+  "-", "ok", "error", "timeout", "urc", "user", "reset",
+};
+
+static const char *coreStates[] = {
+  "NON_ACTIVE", "CHECK_AT", "CHECK_SIMCARD", "CHECK_NETWORK", "ACTIVE",
+};
+
+static const char *netStates[] = {
+  "NON_ACTIVE", "SETUP_APN", "CHECK_GPRS", "ONLINE",
+};
+
+static const char *sockMgrStates[] = {
+  "NET_CLOSE", "NET_OPENING", "NET_OPEN_PENDING", "NET_OPEN",
+};
+
+static const char *socketStates[] = {
+  "CLOSE", "WAIT_NETOPEN", "OPENING", "OPEN_PENDING", "OPEN",
+};
+
+static const char *gpsStates[] = {
+  "NON_ACTIVE", "SETUP", "ACTIVE",
+};
+
+static const char *httpStates[] = {
+  "AVAILABLE", "STARTING", "REQUESTING", "GET_RESP", "READING_CONTENT",
+  "GET_BUF_CONTENT", "DONE",
+};
+
+static const char *powerStates[] = {
+  "ACTIVE", "SLEEP", "PSM",
+};
+
+static const char *watchdogStages[] = {
+  "IDLE", "DETECTED", "SOFT_RESET", "HARD_RESET", "RESTORING",
+};
+
+
+static const char *stateName(uint8_t module, uint8_t state)
+{
+  switch (module) {
+  case 0: return NAMES(coreStates, state);
+  case 1: return NAMES(netStates, state);
+  case 2: return NAMES(sockMgrStates, state);
+  case 3: return NAMES(socketStates, state);
+  case 4: return NAMES(gpsStates, state);
+  case 5: return NAMES(httpStates, state);
+  case 6: return NAMES(powerStates, state);
+  case 7: return NAMES(watchdogStages, state);
+  default: return "?";
+  }
+}
+
+
+static uint32_t le32(const uint8_t *p)
+{
+  return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+
+int main(int argc, char **argv)
+{
+  FILE *fp = stdin;
+  uint8_t header[TRACE_HEADER_SIZE];
+  uint8_t record[32];
+  uint8_t recordSize;
+  uint16_t count;
+  uint32_t lost;
+  uint32_t prevTick = 0;
+  char module[16];
+
+  if (argc > 1 && strcmp(argv[1], "-") != 0) {
+    fp = fopen(argv[1], "rb");
+    if (fp == NULL) {
+      perror(argv[1]);
+      return 1;
+    }
+  }
+
+  if (fread(header, 1, sizeof(header), fp) != sizeof(header) || le32(header) != TRACE_MAGIC) {
+    fprintf(stderr, "not a trace dump\n");
+    return 1;
+  }
+  if (header[4] != TRACE_VERSION) {
+    fprintf(stderr, "unsupported trace version %u\n", header[4]);
+    return 1;
+  }
+  recordSize = header[5];
+  count = (uint16_t) (header[6] | (header[7] << 8));
+  lost = le32(&header[8]);
+  if (recordSize < 8 || recordSize > sizeof(record)) {
+    fprintf(stderr, "bad record size %u\n", recordSize);
+    return 1;
+  }
+
+  printf("%u records, %u lost\n", count, lost);
+  printf("%10s %8s  %-10s %-16s    %-16s %s\n",
+         "tick", "delta", "module", "from", "to", "cause");
+
+  for (uint16_t i = 0; i < count; i++) {
+    uint32_t tick;
+    uint8_t mod;
+
+    if (fread(record, 1, recordSize, fp) != recordSize) {
+      fprintf(stderr, "truncated at record %u\n", i);
+      return 1;
+    }
+    tick = le32(record);
+    mod = record[4] & 0x0F;
+    if (mod == 3) {
+      snprintf(module, sizeof(module), "socket.%u", record[4] >> 4);
+    } else {
+      snprintf(module, sizeof(module), "%s", NAMES(modules, mod));
+    }
+
+    printf("%10u %8u  %-10s %-16s -> %-16s %s\n",
+           tick, i? tick - prevTick: 0, module,
+           stateName(mod, record[5]), stateName(mod, record[6]),
+           NAMES(causes, record[7]));
+    prevTick = tick;
+  }
+
+  if (fp != stdin) fclose(fp);
+  return 0;
+}